@@ -0,0 +1,445 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+
+#include "cube.h"
+#include "dlx.h"
+#include "globals.h"
+#include "packing.h"
+#include "table.h"
+
+/*
+ * The baseline which is compared against unless another one or an empty name is given. It holds
+ * the output of -s for each engine, which is to be saved again whenever the node counts change.
+ */
+#ifndef BENCH_BASELINE
+#define BENCH_BASELINE "bench_baseline.txt"
+#endif
+
+/* The names of the engines in the baseline. */
+static const char *BACKEND_NAMES[] = { [DLX_LINKS] = "links", [DLX_BITBOARD] = "bitboard", [DLX_SPARSE] = "sparse" };
+
+/* The outcome of running a workload once. */
+struct result {
+    /* The number of solutions or the best score for the cube. */
+    double value;
+    /* The number of rows which were added to the solution. */
+    uint64_t nodes;
+    double seconds;
+};
+
+/* A fixed problem whose search is timed. */
+struct workload {
+    const char *name;
+    /* Runs the workload with the given parameter. */
+    void (*run)(int param, enum dlx_backend backend, struct result *result);
+    int param;
+    /* The number of solutions or the best score which the search must report. */
+    double expected;
+};
+
+/**
+ * @return A monotonic timestamp in seconds.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* A packing with the highest score whose rows are placed in advance, one piece after the other. */
+static const uint64_t FIXED_TILES[] = {
+    0x0000800000208011llu, 0x0e0000000000000allu, 0x00000000080c1800llu,
+    0x0000000086030000llu, 0x0000088841000000llu, 0x00f0000010000000llu,
+};
+static const int FIXED_PIECES[] = { 11, 6, 8, 1, 7, 0 };
+
+/**
+ * Searches the cube with the first count pieces of a best packing placed in advance.
+ *
+ * @param count The number of pieces which are placed in advance.
+ * @param backend The engine which is to be used.
+ * @param result[out] The best score and the number of nodes.
+ */
+static void run_cube(int count, enum dlx_backend backend, struct result *result) {
+    uint64_t tiles = 0, pieces = 0;
+    for(int i = 0; i < count; i++)
+        tiles |= FIXED_TILES[i], pieces |= 1llu << FIXED_PIECES[i];
+
+    /* Copy the rows which don't intersect the placed pieces and the placed rows themselves. */
+    int size = 0;
+    for(struct matrix_row *i = load_walks(); i; i = i->next)
+        size++;
+    struct matrix_row *rows = calloc_s(size, sizeof(*rows)), *prev = NULL;
+    struct row_data *rows_data = calloc_s(size, sizeof(*rows_data));
+    int count_kept = 0;
+    for(struct matrix_row *i = load_walks(); i; i = i->next) {
+        struct row_data *data = i->row_data;
+        uint64_t piece = (i->row[0] >> 60 | i->row[1] << 4) & 0xfff;
+        bool fixed = false;
+        for(int j = 0; j < count; j++)
+            fixed |= data->flags == FIXED_TILES[j] && piece == 1llu << FIXED_PIECES[j];
+        if(!fixed && ((data->flags & tiles) || (piece & pieces)))
+            continue;
+
+        struct matrix_row *r = &rows[count_kept];
+        rows_data[count_kept] = *data;
+        rows_data[count_kept].id = count_kept;
+        *r = (struct matrix_row) { i->row, &rows_data[count_kept], prev, NULL };
+        if(prev) prev->next = r;
+        prev = r, count_kept++;
+    }
+
+    static _Atomic int best;
+    atomic_store(&best, 0);
+    double start = now();
+    struct dlx_solver *solver = packing_new(rows, backend);
+    struct table *table = table_new(TABLE_DEFAULT_BITS);
+    struct dlx_data data;
+    packing_data_init(&data, &best, NULL, table, NULL);
+    dlx_solve(solver, &data);
+    result->seconds = now() - start;
+    result->value = atomic_load(&best) / 6.0;
+    result->nodes = data.nodes;
+
+    packing_data_free(&data);
+    packing_free(solver);
+    table_free(table);
+    free(rows);
+    free(rows_data);
+}
+
+/* Counts the solutions and nodes of the generic workloads. */
+struct counter {
+    uint64_t solutions, nodes;
+};
+
+static bool count_solution(struct dlx_context *context) {
+    ((struct counter *) context->dlx_data)->solutions++;
+    return false;
+}
+
+static void count_node(void *dlx_data, struct matrix_row *row) {
+    (void) row;
+    ((struct counter *) dlx_data)->nodes++;
+}
+
+static void ignore_node(void *dlx_data, struct matrix_row *row) { (void) dlx_data, (void) row; }
+
+/* The rows of a generic workload. */
+struct matrix {
+    struct matrix_row *rows;
+    int column_count, row_count, row_capacity;
+    /* The number of columns at the end which are secondary, see dlx_set_secondary. */
+    int secondary;
+};
+
+/**
+ * @param matrix[in,out] The matrix to which an empty row is to be added.
+ * @return The new row.
+ */
+static struct matrix_row *matrix_add(struct matrix *matrix) {
+    if(matrix->row_count == matrix->row_capacity) {
+        matrix->row_capacity = matrix->row_capacity ? matrix->row_capacity * 2 : 256;
+        matrix->rows = realloc_s(matrix->rows, matrix->row_capacity * sizeof(*matrix->rows));
+    }
+    struct matrix_row *row = &matrix->rows[matrix->row_count++];
+    row->row = calloc_s(dlx_words(matrix->column_count), sizeof(uint64_t));
+    row->row_data = NULL;
+    return row;
+}
+
+/**
+ * Counts the solutions of the matrix, which is freed afterwards.
+ *
+ * @param matrix[in] The matrix whose solutions are to be counted.
+ * @param backend The engine which is to be used.
+ * @param result[out] The number of solutions and nodes.
+ */
+static void run_matrix(struct matrix *matrix, enum dlx_backend backend, struct result *result) {
+    struct counter counter = { 0, 0 };
+    double start = now();
+    struct dlx_solver *solver = dlx_new_backend(matrix->column_count, backend);
+    dlx_set_secondary(solver, matrix->secondary);
+    for(int i = 0; i < matrix->row_count; i++)
+        dlx_row(solver, &matrix->rows[i]);
+    dlx_set_callback(solver, count_solution);
+    dlx_set_ba(solver, count_node, ignore_node);
+    dlx_solve(solver, &counter);
+    result->seconds = now() - start;
+    result->value = counter.solutions;
+    result->nodes = counter.nodes;
+
+    dlx_free(solver);
+    for(int i = 0; i < matrix->row_count; i++)
+        free(matrix->rows[i].row);
+    free(matrix->rows);
+}
+
+/**
+ * Adds a row for each square of an n by n board, covering its rank, its file, its diagonal and its
+ * anti-diagonal, in the columns of that order.
+ *
+ * @param matrix[in,out] The matrix of 6n - 2 columns to which the rows are to be added.
+ * @param n The size of the board.
+ */
+static void add_queens(struct matrix *matrix, int n) {
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < n; j++) {
+            struct matrix_row *row = matrix_add(matrix);
+            dlx_set(row, i);
+            dlx_set(row, n + j);
+            dlx_set(row, 2 * n + i + j);
+            dlx_set(row, 4 * n - 1 + i - j + n - 1);
+        }
+    }
+}
+
+/**
+ * Counts the ways to place n queens on an n by n board. The diagonals are covered by the queens or
+ * by a slack row each, since they may remain empty.
+ *
+ * @param n The size of the board.
+ * @param backend The engine which is to be used.
+ * @param result[out] The number of solutions and nodes.
+ */
+static void run_queens(int n, enum dlx_backend backend, struct result *result) {
+    struct matrix matrix = { .column_count = 6 * n - 2 };
+    add_queens(&matrix, n);
+    for(int i = 2 * n; i < 6 * n - 2; i++)
+        dlx_set(matrix_add(&matrix), i);
+    run_matrix(&matrix, backend, result);
+}
+
+/**
+ * Counts the ways to place n queens like run_queens, but with secondary columns for the diagonals
+ * instead of the slack rows.
+ *
+ * @param n The size of the board.
+ * @param backend The engine which is to be used.
+ * @param result[out] The number of solutions and nodes.
+ */
+static void run_queens_secondary(int n, enum dlx_backend backend, struct result *result) {
+    struct matrix matrix = { .column_count = 6 * n - 2, .secondary = 4 * n - 2 };
+    add_queens(&matrix, n);
+    run_matrix(&matrix, backend, result);
+}
+
+/* The pentominoes as cells of a 5 by 5 grid, in the order F I L N P T U V W X Y Z. */
+static const int PENTOMINOES[12][5][2] = {
+    { { 0, 1 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 2, 1 } },
+    { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 4, 0 } },
+    { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 3, 1 } },
+    { { 0, 1 }, { 1, 1 }, { 2, 0 }, { 2, 1 }, { 3, 0 } },
+    { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 }, { 2, 0 } },
+    { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 2, 1 } },
+    { { 0, 0 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 1, 2 } },
+    { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 2, 1 }, { 2, 2 } },
+    { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 2, 1 }, { 2, 2 } },
+    { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, 2 }, { 2, 1 } },
+    { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 2, 1 }, { 3, 1 } },
+    { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 }, { 2, 2 } },
+};
+
+/**
+ * Counts the ways to tile a 6 by 10 rectangle with the 12 pentominoes. The X pentomino is kept in
+ * one quarter of the rectangle so that each tiling is only counted once.
+ *
+ * @param width The width of the rectangle, which has 60 / width rows.
+ * @param backend The engine which is to be used.
+ * @param result[out] The number of solutions and nodes.
+ */
+static void run_pentominoes(int width, enum dlx_backend backend, struct result *result) {
+    int height = 60 / width;
+    struct matrix matrix = { .column_count = 72 };
+    for(int p = 0; p < 12; p++) {
+        /* The masks of the orientations which have already been placed at the origin. */
+        uint32_t seen[8];
+        int seen_count = 0;
+        for(int o = 0; o < 8; o++) {
+            int cells[5][2], min_y = 5, min_x = 5;
+            for(int i = 0; i < 5; i++) {
+                int y = PENTOMINOES[p][i][0], x = PENTOMINOES[p][i][1];
+                if(o & 4) { int t = y; y = x; x = t; }
+                if(o & 2) y = 4 - y;
+                if(o & 1) x = 4 - x;
+                cells[i][0] = y, cells[i][1] = x;
+                if(y < min_y) min_y = y;
+                if(x < min_x) min_x = x;
+            }
+
+            uint32_t mask = 0;
+            for(int i = 0; i < 5; i++)
+                cells[i][0] -= min_y, cells[i][1] -= min_x,
+                mask |= 1u << (cells[i][0] * 5 + cells[i][1]);
+            bool duplicate = false;
+            for(int i = 0; i < seen_count; i++)
+                duplicate |= seen[i] == mask;
+            if(duplicate) continue;
+            seen[seen_count++] = mask;
+
+            for(int y = 0; y < height; y++) {
+                for(int x = 0; x < width; x++) {
+                    bool fits = true;
+                    for(int i = 0; i < 5; i++)
+                        fits &= y + cells[i][0] < height && x + cells[i][1] < width;
+                    /* The centre of the X pentomino is kept in the upper left quarter. */
+                    if(!fits || (p == 9 && (y + 1 >= height / 2 || x + 1 >= width / 2)))
+                        continue;
+
+                    struct matrix_row *row = matrix_add(&matrix);
+                    dlx_set(row, 60 + p);
+                    for(int i = 0; i < 5; i++)
+                        dlx_set(row, (y + cells[i][0]) * width + x + cells[i][1]);
+                }
+            }
+        }
+    }
+    run_matrix(&matrix, backend, result);
+}
+
+static const struct workload WORKLOADS[] = {
+    { "cube-4", run_cube, 4, 47 },
+    { "cube-3", run_cube, 3, 47 },
+    { "cube-2", run_cube, 2, 47 },
+    { "cube-1", run_cube, 1, 47 },
+    { "queens-12", run_queens, 12, 14200 },
+    { "queens-secondary-12", run_queens_secondary, 12, 14200 },
+    { "pentominoes-6x10", run_pentominoes, 10, 2339 },
+};
+
+/**
+ * @param file[in] The baseline which is to be searched.
+ * @param backend The engine whose entry is to be found, since the engines visit different nodes.
+ * @param name[in] The name of the workload.
+ * @param nodes[out] The number of nodes of the workload in the baseline.
+ * @param seconds[out] The time of the workload in the baseline.
+ *
+ * @return True iff the baseline contains the workload.
+ */
+static bool find_baseline(FILE *file, enum dlx_backend backend, const char *name, uint64_t *nodes,
+                          double *seconds) {
+    if(!file) return false;
+    rewind(file);
+    char line[256], engine[32], entry[128];
+    unsigned long long n;
+    while(fgets(line, sizeof(line), file))
+        if(sscanf(line, "%31s %127s %llu %lf", engine, entry, &n, seconds) == 4 &&
+           !strcmp(engine, BACKEND_NAMES[backend]) && !strcmp(entry, name))
+            return *nodes = n, true;
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    enum dlx_backend backend = DLX_LINKS;
+    int repeat = 3;
+    const char *baseline = BENCH_BASELINE, *save = NULL;
+
+    static const struct option options[] = {
+        { "bitboard", no_argument, NULL, 'b' },
+        { "sparse", no_argument, NULL, 'x' },
+        { "repeat", required_argument, NULL, 'r' },
+        { "baseline", required_argument, NULL, 'c' },
+        { "save", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    for(int c; (c = getopt_long(argc, argv, "bxr:c:s:", options, NULL)) != -1; ) {
+        switch(c) {
+            case 'b':
+                backend = DLX_BITBOARD;
+                break;
+            case 'x':
+                backend = DLX_SPARSE;
+                break;
+            case 'r':
+                repeat = atoi(optarg);
+                if(repeat < 1) repeat = 1;
+                break;
+            case 'c':
+                baseline = optarg;
+                break;
+            case 's':
+                save = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-b | -x] [-r repeat] [-c baseline] [-s save] [workload...]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    FILE *base = *baseline ? fopen(baseline, "r") : NULL;
+    if(*baseline && !base) {
+        fprintf(stderr, "Failed to open baseline: %s\n", baseline);
+        return 1;
+    }
+    FILE *out = save ? fopen(save, "w") : NULL;
+    if(save && !out) {
+        fprintf(stderr, "Failed to open: %s\n", save);
+        return 1;
+    }
+
+    int result = 0;
+    printf("%-18s %12s %14s %10s %14s %10s\n", "workload", "result", "nodes", "seconds", "nodes/s", "baseline");
+    for(size_t i = 0; i < sizeof(WORKLOADS) / sizeof(*WORKLOADS); i++) {
+        const struct workload *w = &WORKLOADS[i];
+        /* Only run the workloads which were named, if any. */
+        bool selected = optind == argc;
+        for(int j = optind; j < argc; j++)
+            selected |= !strcmp(argv[j], w->name);
+        if(!selected) continue;
+
+        /* Keep the fastest of the repetitions. */
+        struct result best = { 0, 0, INFINITY };
+        for(int j = 0; j < repeat; j++) {
+            struct result r;
+            w->run(w->param, backend, &r);
+            if(r.seconds < best.seconds) best = r;
+        }
+
+        char compare[32] = "-";
+        uint64_t nodes;
+        double seconds;
+        if(find_baseline(base, backend, w->name, &nodes, &seconds)) {
+            if(nodes != best.nodes)
+                snprintf(compare, sizeof(compare), "nodes %+.1f%%", 100.0 * ((double) best.nodes / nodes - 1));
+            else
+                snprintf(compare, sizeof(compare), "%+.1f%%", 100.0 * (best.seconds / seconds - 1));
+        }
+        printf("%-18s %12g %14llu %10.3f %14.0f %10s\n", w->name, best.value,
+               (unsigned long long) best.nodes, best.seconds, best.nodes / best.seconds, compare);
+        if(best.value < w->expected - 0.001 || best.value > w->expected + 0.001) {
+            fprintf(stderr, "%s: expected %g but got %g\n", w->name, w->expected, best.value);
+            result = 1;
+        }
+        if(out)
+            fprintf(out, "%s %s %llu %.6f\n", BACKEND_NAMES[backend], w->name, (unsigned long long) best.nodes,
+                    best.seconds);
+    }
+
+    if(base) fclose(base);
+    if(out && fclose(out)) {
+        fprintf(stderr, "Failed to write: %s\n", save);
+        result = 1;
+    }
+    return result;
+}
@@ -17,11 +17,7 @@
 
 #include "cube.h"
 
-#include <stdbool.h>
-
-#include "globals.h"
-
-enum direction GENERATOR_PENTOMINOS[12][4][4] = {
+const enum direction GENERATOR_PENTOMINOS[12][4][4] = {
     { { UP, UP, UP, UP } },
     { { UP, RIGHT }, { LEFT }, { DOWN } },
     { { DOWN, DOWN, DOWN, RIGHT } },
@@ -36,7 +32,7 @@ enum direction GENERATOR_PENTOMINOS[12][4][4] = {
     { { RIGHT, UP, UP, RIGHT } }
 };
 
-int NEIGHBOUR_MATRIX[60][4] = {
+const int NEIGHBOUR_MATRIX[60][4] = {
     { 55, 15,  4, 59 }, /*  0 */ { 57,  2,  5, 56 }, /*  1 */ { 58,  3,  6,  1 }, /*  2 */
     { 59,  4,  7,  2 }, /*  3 */ {  0, 14,  8,  3 }, /*  4 */ {  1,  6,  9, 22 }, /*  5 */
     {  2,  7, 10,  5 }, /*  6 */ {  3,  8, 11,  6 }, /*  7 */ {  4, 13, 12,  7 }, /*  8 */
@@ -59,7 +55,7 @@ int NEIGHBOUR_MATRIX[60][4] = {
     { 53, 58,  1, 56 }, /* 57 */ { 54, 59,  2, 57 }, /* 58 */ { 55,  0,  3, 58 }, /* 59 */
 };
 
-int ROTATION_MATRIX[60][4] = {
+const int ROTATION_MATRIX[60][4] = {
     { 3, 1, 0, 0 }, /*  0 */ { 0, 0, 0, 1 }, /*  1 */ { 0, 0, 0, 0 }, /*  2 */
     { 0, 0, 0, 0 }, /*  3 */ { 0, 1, 0, 0 }, /*  4 */ { 0, 0, 0, 3 }, /*  5 */
     { 0, 0, 0, 0 }, /*  6 */ { 0, 0, 0, 0 }, /*  7 */ { 0, 1, 0, 0 }, /*  8 */
@@ -82,9 +78,9 @@ int ROTATION_MATRIX[60][4] = {
     { 0, 0, 0, 0 }, /* 57 */ { 0, 0, 0, 0 }, /* 58 */ { 0, 0, 0, 0 }, /* 59 */
 };
 
-/* The split cube areas. */
-static const double S = 1.0 / 6.0, M = 1.0 / 2.0, B = 5.0 / 6.0, N = 1;
-double AREA_MATRIX[60][6] = {
+/* The split cube areas in sixths. */
+enum { S = 1, M = 3, B = 5, N = 6 };
+const uint8_t AREA_MATRIX[60][6] = {
    /* 0  1  2  3  4  5               0  1  2  3  4  5 */
     { S, 0, 0, B, 0, 0 }, /*  0 */ { B, S, 0, 0, 0, 0 }, /*  1 */
     { N, 0, 0, 0, 0, 0 }, /*  2 */ { N, 0, 0, 0, 0, 0 }, /*  3 */
@@ -117,165 +113,3 @@ double AREA_MATRIX[60][6] = {
     { 0, B, 0, 0, 0, S }, /* 56 */ { S, 0, 0, 0, 0, B }, /* 57 */
     { M, 0, 0, 0, 0, M }, /* 58 */ { B, 0, 0, 0, 0, S }, /* 59 */
 };
-
-/**
- * @param s The starting node of the walk.
- * @param rot The starting rotation of the walk.
- * @param seq The sequence of steps to perform.
- *
- * @return The nodes which were visited during the graph walk.
- */
-static struct matrix_row *generate_walk(int s, int rot, enum direction seq[][4]) {
-    struct matrix_row *row = calloc_s(1, sizeof(*row));
-    row->row = calloc_s(72, sizeof(int));
-
-    struct row_data *data = calloc_s(1, sizeof(*data));
-    row->row_data = data;
-
-    data->flags |= 1llu << (unsigned) s;
-    row->row[s] = 1;
-    for(int i = 0; i < 4; i++) {
-        int curr_pos = s;
-        int curr_rot = rot;
-        for(int j = 0; j < 4; j++) {
-            enum direction next = seq[i][j];
-            if(next == NOP) break;
-            next = rotate(next, curr_rot);
-            curr_rot += ROTATION_MATRIX[curr_pos][next - 1];
-            curr_pos = NEIGHBOUR_MATRIX[curr_pos][next - 1];
-            /* Ensure that 5 unique nodes were visited. */
-            if(row->row[curr_pos] == 1) {
-                free(row->row_data);
-                free(row->row);
-                free(row);
-                return NULL;
-            }
-            data->flags |= 1llu << (unsigned) curr_pos;
-            row->row[curr_pos] = 1;
-        }
-    }
-    return row;
-}
-
-/**
- * @param a[in] The 1st row which is to be compared to the 2nd.
- * @param b[in] The 2nd row which is to be compared to the 1st.
- *
- * @return True iff the two rows are the same false otherwise.
- */
-static bool row_equals(struct matrix_row *a, struct matrix_row *b) {
-    for(int i = 0; i < 72; i++)
-        if(a->row[i] != b->row[i])
-            return false;
-    return true;
-}
-
-/**
- * Simply removes duplicates from the linked list. This might not be the fastest
- * approach but its fast enough.
- *
- * @param[in,out] matrix The matrix which is to be optimized.
- */
-static void dedupe_walks(struct matrix_row *matrix) {
-    struct matrix_row *d = NULL;
-    for(struct matrix_row *i = matrix; i; i = i->next)
-        for(struct matrix_row *j = i->next, *p = i; j; p = j, j = j->next)
-            if(row_equals(i, j))
-                /* Mark as to be deleted and unlink. */
-                p->next = j->next, j->next = d, d = j, j = p;
-
-    while(d) {
-        struct matrix_row *tmp = d;
-        d = d->next;
-        free(tmp->row_data);
-        free(tmp->row);
-        free(tmp);
-    }
-}
-
-/**
- * Assigns each walk a weight.
- * @param matrix[in,out] The matrix which is to be weighted.
- */
-static void weight_walks(struct matrix_row *matrix) {
-    for(struct matrix_row *i = matrix; i; i = i->next) {
-        struct row_data *data = i->row_data;
-        /* Construct the function. */
-        double weights[6] = { };
-        for(int j = 0; j < 60; j++)
-            if(i->row[j])
-                for(int k = 0; k < 6; k++)
-                    weights[k] += AREA_MATRIX[j][k];
-        /* Maximize the function. */
-        double max = weights[0];
-        for(int j = 1; j < 6; j++)
-            if(max < weights[j])
-                max = weights[j];
-        data->weight = max;
-    }
-}
-
-/**
- * @param a[in] The 1st parameter that should be compared to the 2nd.
- * @param b[in] The 2nd parameter that should be compared to the 1st.
- * @return A value less than 0 iff a < b, 0 iff a = b and a value greater than 0 iff a > b.
- */
-static int cmp_matrix_row(const void *a, const void *b) {
-    struct row_data *ad = (*(struct matrix_row **) a)->row_data;
-    struct row_data *bd = (*(struct matrix_row **) b)->row_data;
-
-    return ad->weight > bd->weight ? -1 :
-           ad->weight < bd->weight ?  1 : 0;
-}
-
-/**
- * @param matrix[in] The rows which are to be sorted.
- * @return The sorted linked list.
- */
-static struct matrix_row *sort_walks(struct matrix_row *matrix) {
-    int size = 0;
-    for(struct matrix_row *i = matrix; i; i = i->next)
-        size++;
-
-    struct matrix_row *rows[size + 1], **tmp = rows;
-    for(struct matrix_row *i = matrix; i; i = i->next)
-        *tmp = i, tmp++;
-    rows[size] = NULL;
-
-    qsort(rows, size, sizeof(struct matrix_row *), cmp_matrix_row);
-
-    rows[0]->next = rows[1];
-    for(int i = 1; i < size; i++)
-        rows[i]->prev = rows[i - 1],
-        rows[i]->next = rows[i + 1];
-    return rows[0];
-}
-
-struct matrix_row *generate_walks() {
-    struct matrix_row *result = NULL;
-    enum direction flipped[4][4];
-    for(int i = 0; i < 12; i++) {
-        /* Flip the walk. */
-        for(int j = 0; j < 4; j++)
-            for(int k = 0; k < 4; k++)
-                flipped[j][k] = flip(GENERATOR_PENTOMINOS[i][j][k]);
-
-        for(int j = 0; j < 60; j++) {
-            for(int k = 1; k < 5; k++) {
-                struct matrix_row *walk = generate_walk(j, k, GENERATOR_PENTOMINOS[i]);
-                if(walk)
-                    walk->next = result, walk->row[i + 60] = 1, result = walk;
-            }
-
-            for(int k = 1; k < 5; k++) {
-                struct matrix_row *walk = generate_walk(j, k, flipped);
-                if(walk)
-                    walk->next = result, walk->row[i + 60] = 1, result = walk;
-            }
-        }
-    }
-    dedupe_walks(result);
-    weight_walks(result);
-    result = sort_walks(result);
-    return result;
-}
@@ -18,6 +18,7 @@
 #ifndef CUBE_H
 #define CUBE_H
 
+#include <math.h>
 #include <stdint.h>
 
 #include "dlx.h"
@@ -43,23 +44,47 @@ static inline enum direction flip(enum direction dir) {
 }
 
 /* Encodes each pentomino as a set of graph walks. */
-enum direction GENERATOR_PENTOMINOS[12][4][4];
+extern const enum direction GENERATOR_PENTOMINOS[12][4][4];
 /* Encodes the cube as a graph where each node has 4 neighbours. */
-int NEIGHBOUR_MATRIX[60][4];
+extern const int NEIGHBOUR_MATRIX[60][4];
 /* Applies the required rotation at each step to perform the walk. */
-int ROTATION_MATRIX[60][4];
-/* Maps each tile to a cube-face and it's area for that cube face. */
-double AREA_MATRIX[60][6];
+extern const int ROTATION_MATRIX[60][4];
+/* Maps each tile to a cube-face and it's area for that cube face in sixths. */
+extern const uint8_t AREA_MATRIX[60][6];
+/* Maps each tile to its image under each of the symmetries which preserve the cover matrix. */
+extern const int SYMMETRY_MATRIX[48][60];
+/* The number of symmetries including the identity. */
+extern const int SYMMETRY_COUNT;
 
 struct row_data {
-    double weight;
+    /* The weight in sixths, every weight and score is counted in sixths so that ties are exact. */
+    uint8_t weight;
     uint64_t flags;
+    /* The position of the row in the weight sorted matrix. */
+    int id;
 };
 
+/* A row of the cover matrix reduced to the piece and the tiles it covers. */
+struct placement {
+    uint64_t flags;
+    int piece;
+    uint8_t weight;
+};
+
+/**
+ * @param score A score, which may be off by rounding errors if it was read back from the output.
+ * @return The least number of sixths which reaches the score.
+ */
+static inline int score_sixths(double score) {
+    return (int) ceil(score * 6 - 1e-6);
+}
+
 /**
- * Generates the rows needed for the exact cover formulation.
+ * Loads the rows of the exact cover formulation from the table generated at build time. The rows
+ * are sorted by their weight and live in static storage.
+ *
  * @return The matrix rows of the exact cover formulation.
  */
-struct matrix_row *generate_walks();
+struct matrix_row *load_walks();
 
 #endif /* CUBE_H */
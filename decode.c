@@ -0,0 +1,82 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cube.h"
+#include "dlx.h"
+#include "globals.h"
+#include "sink.h"
+
+/*
+ * Converts solutions written in the binary format of the sink back into the text format. The ids
+ * refer to the rows of the placement table, so the stream must be decoded with the same build.
+ */
+int main(int argc, char *argv[]) {
+    if(argc > 2) {
+        fprintf(stderr, "Usage: %s [solutions]\n", argv[0]);
+        return 1;
+    }
+    FILE *input = argc == 2 ? fopen(argv[1], "rb") : stdin;
+    if(!input) {
+        fprintf(stderr, "Failed to open: %s\n", argv[1]);
+        return 1;
+    }
+
+    /* Index the rows by their id. */
+    int row_count = 0;
+    for(struct matrix_row *i = load_walks(); i; i = i->next)
+        row_count++;
+    struct matrix_row **rows = malloc_s(row_count * sizeof(*rows));
+    for(struct matrix_row *i = load_walks(); i; i = i->next)
+        rows[((struct row_data *) i->row_data)->id] = i;
+
+    char magic[sizeof(SINK_MAGIC) - 1];
+    uint32_t count;
+    if(fread(magic, 1, sizeof(magic), input) != sizeof(magic) || memcmp(magic, SINK_MAGIC, sizeof(magic)) ||
+       fread(&count, sizeof(count), 1, input) != 1 || count != (uint32_t) row_count) {
+        fprintf(stderr, "Not a stream of solutions of this build\n");
+        return 1;
+    }
+
+    int result = 0;
+    for(double score; fread(&score, sizeof(score), 1, input) == 1; ) {
+        uint8_t size;
+        uint16_t ids[SINK_ROWS];
+        struct matrix_row *solution[SINK_ROWS];
+        if(fread(&size, sizeof(size), 1, input) != 1 || size > SINK_ROWS ||
+           fread(ids, sizeof(*ids), size, input) != size) {
+            fprintf(stderr, "Truncated solution\n");
+            result = 1;
+            break;
+        }
+
+        for(int i = 0; i < size; i++) {
+            if(ids[i] >= row_count) {
+                fprintf(stderr, "Invalid row: %d\n", ids[i]);
+                return 1;
+            }
+            solution[i] = rows[ids[i]];
+        }
+        sink_print(stdout, score, solution, size);
+    }
+
+    if(input != stdin) fclose(input);
+    free(rows);
+    return result;
+}
@@ -16,106 +16,138 @@
  */
 
 #include "dlx.h"
+#include "dlx_internal.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
 #include "globals.h"
 
 /**
- * @param col_id The column's id.
- * @param prev[in] The previous column object.
- * @param next[in] The next column object.
+ * Resizes the arena holding the matrix, keeping the nodes which have already been created.
  *
- * @return A new instance of a column object.
+ * @param dlx[in] The solver whose arena is to be resized.
+ * @param capacity The number of nodes the arena should be able to hold.
  */
-static struct dlx_node *column_new(int col_id, struct dlx_node *prev, struct dlx_node *next) {
-    struct dlx_node *column = malloc_s(sizeof(*column));
-    column->U = column->D = column;
-    column->R = next, column->L = prev;
-    column->size = 0, column->col_id = col_id;
-    return column;
+static void arena_resize(struct dlx_solver *dlx, int capacity) {
+    int32_t *arena = malloc_s((dlx->column_count + 6 * (size_t) capacity) * sizeof(*arena));
+    int32_t **links[] = { &dlx->U, &dlx->D, &dlx->L, &dlx->R, &dlx->C, &dlx->row };
+
+    if(dlx->arena)
+        memcpy(arena, dlx->size, dlx->column_count * sizeof(*arena));
+    dlx->size = arena;
+    for(int i = 0; i < 6; i++) {
+        int32_t *link = arena + dlx->column_count + (size_t) i * capacity;
+        if(dlx->arena)
+            memcpy(link, *links[i], dlx->node_count * sizeof(*link));
+        *links[i] = link;
+    }
+    free(dlx->arena);
+    dlx->arena = arena, dlx->node_capacity = capacity;
 }
 
 /**
- * @param row[in] A pointer to the row associated with this node.
- * @param L[in] The node which is located to the left of this node or NULL if there is non.
- * @param C[in] The column which is associated with this node.
+ * @param dlx[in] The solver in whose arena the node is to be created.
+ * @param row The index of the row associated with this node.
+ * @param L The node which is located to the left of this node or -1 if there is non.
+ * @param C The column which is associated with this node.
  *
- * @return A new instance of a node.
+ * @return The index of a new node.
  */
-static struct dlx_node *node_new(struct matrix_row *row, struct dlx_node *L, struct dlx_node *C) {
-    struct dlx_node *node = malloc_s(sizeof(*node));
-    if(L) node->R = L->R, node->L = L;
-    else node->R = node->L = node;
-    node->U = C->U, node->C = node->D = C;
-    node->row = row;
+static int node_new(struct dlx_solver *dlx, int row, int L, int C) {
+    if(dlx->node_count == dlx->node_capacity)
+        arena_resize(dlx, dlx->node_capacity * 2);
+
+    int node = dlx->node_count++;
+    if(L >= 0) dlx->R[node] = dlx->R[L], dlx->L[node] = L;
+    else dlx->R[node] = dlx->L[node] = node;
+    dlx->U[node] = dlx->U[C], dlx->C[node] = dlx->D[node] = C;
+    dlx->row[node] = row;
     return node;
 }
 
-/**
- * Unlinks the given node horizontally.
- * @param node[in] The node which is to be unlinked horizontally.
- */
-static inline void hide_h(struct dlx_node *node) {
-    node->L->R = node->R, node->R->L = node->L;
-}
-
-/**
- * Restores the current node's horizontal links.
- * @param node[in] The node whose links are to be restored horizontally.
- */
-static inline void show_h(struct dlx_node *node) {
-    node->R->L = node->L->R = node;
-}
-
 /**
  * Unlinks the given node vertically.
- * @param node[in] The node which is to be unlinked vertically.
+ * @param dlx[in] The solver whose matrix contains the node.
+ * @param node The node which is to be unlinked vertically.
  */
-static inline void hide_v(struct dlx_node *node) {
-    node->U->D = node->D, node->D->U = node->U;
+static inline void hide_v(struct dlx_solver *dlx, int node) {
+    dlx->D[dlx->U[node]] = dlx->D[node], dlx->U[dlx->D[node]] = dlx->U[node];
 }
 
 /**
  * Restores the current node's vertical links.
- * @param node[in] The node whose links are to be restored vertically.
+ * @param dlx[in] The solver whose matrix contains the node.
+ * @param node The node whose links are to be restored vertically.
  */
-static inline void show_v(struct dlx_node *node) {
-    node->D->U = node->U->D = node;
+static inline void show_v(struct dlx_solver *dlx, int node) {
+    dlx->U[dlx->D[node]] = dlx->D[dlx->U[node]] = node;
 }
 
-struct dlx_heuristic {
-    dlx_heuristic_callback callback;
-    struct dlx_heuristic *next;
-};
-
-/* Stores various information related to the current problem. */
-struct dlx_solver {
-    dlx_solution_callback callback;
-    dlx_data_callback before, after;
-
-    struct dlx_heuristic *heuristic;
-
-    int column_count, row_count;
-    struct dlx_node *column;
-};
-
 /* The default stub callbacks. */
-static void stub_solution_callback(struct dlx_context *s) { }
-static void stub_data_callback(void *data, struct dlx_node *r) { }
+static bool stub_solution_callback(struct dlx_context *s) { (void) s; return false; }
+static void stub_data_callback(void *data, struct matrix_row *r) { (void) data, (void) r; }
+
+/* The default search calling the callbacks and heuristics which were added to the solver. */
+#define DLX_SEARCH run_task
+#define DLX_BEFORE(dlx_data, row) dlx->before(dlx_data, row)
+#define DLX_AFTER(dlx_data, row) dlx->after(dlx_data, row)
+#define DLX_HEURISTICS(dlx_data, depth) call_heuristics(dlx, dlx_data, depth)
+#define DLX_CALLBACK(context) dlx->callback(context)
+#include "dlx_search.h"
 
 struct dlx_solver *dlx_new(int column_count) {
-    struct dlx_solver *dlx = malloc_s(sizeof(*dlx));
+    return dlx_new_backend(column_count, DLX_LINKS);
+}
+
+struct dlx_solver *dlx_new_backend(int column_count, enum dlx_backend backend) {
+    struct dlx_solver *dlx = calloc_s(1, sizeof(*dlx));
     dlx->callback = stub_solution_callback;
     dlx->before = dlx->after = stub_data_callback;
-    dlx->heuristic = NULL;
-    dlx->row_count = 0;
-    dlx->column_count = column_count;
-
-    struct dlx_node *next = calloc_s(1, sizeof(*next));
-    struct dlx_node *prev = dlx->column = next->U = next->R = next->D = next->L = next;
-    for(int i = 1; i < column_count; i++)
-        show_h(prev = column_new(i, prev, next));
+    dlx->search = run_task;
+    dlx->column_count = dlx->primary_count = column_count;
+    dlx->columns = malloc_s((column_count + 1) * sizeof(*dlx->columns));
+    dlx->path = malloc_s((column_count + 1) * sizeof(*dlx->path));
+    dlx->solution = malloc_s((column_count + 1) * sizeof(*dlx->solution));
+    DLX_STAT(dlx->stats = calloc_s(column_count + 1, sizeof(*dlx->stats)));
+    dlx->column = -1;
+    dlx->stop = &dlx->stop_flag;
+    atomic_init(&dlx->stop_flag, false);
+
+    /* The bitboard only supports masks of up to 128 columns. */
+    dlx->backend = backend == DLX_BITBOARD && column_count > 128 ? DLX_LINKS : backend;
+    if(dlx->backend != DLX_LINKS)
+        return dlx;
+
+    /* The first column_count nodes are the column headers. */
+    arena_resize(dlx, column_count * 8);
+    dlx->node_count = column_count;
+    for(int i = 0; i < column_count; i++) {
+        dlx->U[i] = dlx->D[i] = dlx->C[i] = i;
+        dlx->L[i] = (i + column_count - 1) % column_count;
+        dlx->R[i] = (i + 1) % column_count;
+        dlx->row[i] = -1, dlx->size[i] = 0;
+    }
+    if(column_count) dlx->column = 0;
     return dlx;
 }
 
+void dlx_set_secondary(struct dlx_solver *dlx, int count) {
+    dlx->primary_count = dlx->column_count - count;
+    if(dlx->backend != DLX_LINKS)
+        return;
+
+    /* The secondary columns are never chosen, so they are taken out of the list of columns. */
+    for(int i = dlx->primary_count; i < dlx->column_count; i++) {
+        hide_h(dlx, i);
+        dlx->L[i] = dlx->R[i] = i;
+    }
+    if(!dlx->primary_count) dlx->column = -1;
+}
+
 void dlx_set_callback(struct dlx_solver *dlx, dlx_solution_callback callback) {
     dlx->callback = callback;
 }
@@ -127,31 +159,26 @@ void dlx_set_ba(struct dlx_solver *dlx, dlx_data_callback before, dlx_data_callb
 void dlx_add_heuristic(struct dlx_solver *dlx, dlx_heuristic_callback callback) {
     struct dlx_heuristic *heuristic = calloc_s(1, sizeof(*heuristic));
     heuristic->callback = callback;
+    heuristic->index = dlx->heuristic_count++;
     heuristic->next = dlx->heuristic, dlx->heuristic = heuristic;
 }
 
-/**
- * Frees the rows of the given column.
- * @param column[in] The column whose rows are to be freed.
- */
-static void dlx_column_free(struct dlx_node *column) {
-    struct dlx_node *i = column->D;
-    while(i != column) {
-        struct dlx_node *tmp = i;
-        i = i->D;
-        free(tmp);
-    }
+void dlx_set_search(struct dlx_solver *dlx, dlx_search_callback search) {
+    dlx->search = search ? search : run_task;
 }
 
 void dlx_free(struct dlx_solver *dlx) {
-    /* Free the matrix. */
-    struct dlx_node *i = dlx->column;
-    do {
-        struct dlx_node *tmp = i;
-        i = i->R;
-        dlx_column_free(tmp);
-        free(tmp);
-    } while(i != dlx->column);
+    if(dlx->bitboard) bitboard_free(dlx->bitboard);
+    if(dlx->sparse) sparse_free(dlx->sparse);
+    free(dlx->arena);
+    DLX_BUCKET(free(dlx->buckets));
+    free(dlx->rows);
+    free(dlx->columns);
+    free(dlx->path);
+    free(dlx->solution);
+    DLX_STAT(free(dlx->stats));
+    dlx_reset(dlx);
+    free(dlx->tasks);
 
     /* Free the list of heuristics. */
     struct dlx_heuristic *j = dlx->heuristic;
@@ -164,114 +191,818 @@ void dlx_free(struct dlx_solver *dlx) {
 }
 
 void dlx_row(struct dlx_solver *dlx, struct matrix_row *row) {
-    struct dlx_node *column = dlx->column, *prev = NULL;
-    for(int i = 0; i < dlx->column_count; i++) {
-        if(row->row[i]) {
-            prev = node_new(row, prev, column);
-            show_v(prev);
-            show_h(prev);
-            column->size++;
+    if(dlx->backend == DLX_LINKS) {
+        int prev = -1;
+        for(int w = 0; w < dlx_words(dlx->column_count); w++) {
+            for(uint64_t bits = row->row[w]; bits; bits &= bits - 1) {
+                int i = w * 64 + __builtin_ctzll(bits);
+                prev = node_new(dlx, dlx->row_count, prev, i);
+                show_v(dlx, prev);
+                show_h(dlx, prev);
+                dlx->size[i]++;
+            }
+        }
+        /* The buckets are rebuilt with the new sizes. */
+        DLX_BUCKET(free(dlx->buckets));
+        DLX_BUCKET(dlx->buckets = NULL);
+    }
+
+    if(dlx->row_count == dlx->row_capacity) {
+        dlx->row_capacity = dlx->row_capacity ? dlx->row_capacity * 2 : 64;
+        dlx->rows = realloc_s(dlx->rows, dlx->row_capacity * sizeof(*dlx->rows));
+    }
+    dlx->rows[dlx->row_count++] = row;
+}
+
+struct dlx_task *task_new(int depth) {
+    struct dlx_task *task = malloc_s(sizeof(*task) + (depth + 1) * sizeof(task->path[0]));
+    task->base = task->depth = depth;
+    task->path[depth].column = task->path[depth].row = -1;
+    return task;
+}
+
+void dlx_push_task(struct dlx_solver *dlx, struct dlx_task *task) {
+    if(dlx->task_count == dlx->task_capacity) {
+        dlx->task_capacity = dlx->task_capacity ? dlx->task_capacity * 2 : 8;
+        dlx->tasks = realloc_s(dlx->tasks, dlx->task_capacity * sizeof(*dlx->tasks));
+    }
+    dlx->tasks[dlx->task_count++] = task;
+}
+
+void dlx_reset(struct dlx_solver *dlx) {
+    for(int i = 0; i < dlx->task_count; i++)
+        free(dlx->tasks[i]);
+    dlx->task_count = 0;
+}
+
+void dlx_set_shard(struct dlx_solver *dlx, int index, int count, int depth) {
+    dlx->shard_index = index;
+    dlx->shard_count = count > 1 ? count : 0;
+    dlx->shard_depth = depth;
+}
+
+void dlx_stop(struct dlx_solver *dlx) {
+    atomic_store_explicit(dlx->stop, true, memory_order_relaxed);
+}
+
+/**
+ * @param deque[in] The deque to which the task is to be added.
+ * @param task[in] The task which is to be added at the bottom of the deque.
+ */
+static void deque_push(struct dlx_deque *deque, struct dlx_task *task) {
+    pthread_mutex_lock(&deque->lock);
+    if(deque->bottom == deque->capacity) {
+        if(deque->top > deque->capacity / 2) {
+            /* Reclaim the space at the top which was freed up by thieves. */
+            deque->bottom -= deque->top;
+            for(int i = 0; i < deque->bottom; i++)
+                deque->tasks[i] = deque->tasks[i + deque->top];
+            deque->top = 0;
+        } else {
+            deque->capacity = deque->capacity ? deque->capacity * 2 : 64;
+            deque->tasks = realloc_s(deque->tasks, deque->capacity * sizeof(*deque->tasks));
         }
-        column = column->R;
     }
-    dlx->row_count++;
+    deque->tasks[deque->bottom++] = task;
+    atomic_fetch_add_explicit(&deque->size, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&deque->lock);
 }
 
 /**
- * @param start[in] The starting column.
- * @return The column with the least number of vertical nodes.
+ * @param deque[in] The deque from which a task is to be taken.
+ * @param steal True iff the task should be taken from the top of the deque.
+ *
+ * @return The task which was taken or NULL if the deque was empty.
  */
-static struct dlx_node *choose_min(struct dlx_node *start) {
-    struct dlx_node *min = start;
-    for(struct dlx_node *i = min->R; i != start; i = i->R)
-        if(i->size < min->size)
-            min = i;
-    return min;
+static struct dlx_task *deque_take(struct dlx_deque *deque, bool steal) {
+    if(!atomic_load_explicit(&deque->size, memory_order_relaxed))
+        return NULL;
+
+    struct dlx_task *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->top != deque->bottom) {
+        task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+        if(deque->top == deque->bottom)
+            deque->top = deque->bottom = 0;
+        atomic_fetch_sub_explicit(&deque->size, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
 }
 
+void dlx_split(struct dlx_solver *dlx, int depth, int row) {
+    struct dlx_worker *worker = dlx->worker;
+    int column = dlx->columns[depth];
+
+    /* Push the last row first so that the owner continues with the given row. */
+    for(int r = dlx->U[column]; ; r = dlx->U[r]) {
+        struct dlx_task *task = task_new(depth + 1);
+        for(int i = 0; i < depth; i++)
+            task->path[i].column = dlx->columns[i],
+            task->path[i].row = dlx->row[dlx->path[i]];
+        task->path[depth].column = column;
+        task->path[depth].row = dlx->row[r];
+
+        atomic_fetch_add_explicit(&worker->pool->pending, 1, memory_order_relaxed);
+        deque_push(&worker->deque, task);
+        if(r == row) break;
+    }
+}
+
+#ifdef DLX_BUCKETS
 /**
- * Covers the column unlinking the row objects from the matrix.
- * @param dlx[in] For updating the column pointer if needed.
- * @param column[in] The column which is to be covered.
+ * Sorts the columns into buckets by their size.
+ * @param dlx[in] The solver whose buckets are to be built.
  */
-static void cover_column(struct dlx_solver *dlx, struct dlx_node *column) {
-    if(column == dlx->column)
-        dlx->column = column->R == column ? NULL : column->R;
-    hide_h(column);
-    for(struct dlx_node *i = column->D; i != column; i = i->D)
-        for(struct dlx_node *j = i->R; j != i; j = j->R)
-            hide_v(j), j->C->size--;
+static void buckets_build(struct dlx_solver *dlx) {
+    int max = 0;
+    for(int i = 0; i < dlx->column_count; i++)
+        if(dlx->size[i] > max) max = dlx->size[i];
+
+    dlx->bucket_words = dlx_words(dlx->column_count);
+    dlx->bucket_count = max + 1;
+    dlx->buckets = calloc_s(dlx->bucket_count * dlx->bucket_words, sizeof(*dlx->buckets));
+    dlx->min_size = 0;
+    for(int i = 0; i < dlx->primary_count; i++)
+        bucket_toggle(dlx->buckets, dlx->bucket_words, i, dlx->size[i]);
 }
+#endif
+
+/*
+ * The following functions walk the tree on the rows rather than the links, so that they support
+ * every backend and leave the matrix of the search untouched. The live rows of a node are the
+ * indices of the rows which don't intersect the rows chosen so far, in the order in which the
+ * search tries them.
+ */
 
 /**
- * Uncovers the column object relinking the row objects.
- * @param dlx[in] For restoring the column pointer if needed.
- * @param column[in] The column which is to be uncovered.
+ * @param dlx[in] The solver whose tree is walked.
+ * @param live[in] The live rows of the node.
+ * @param live_count The number of live rows.
+ * @param covered[in] The columns which are covered by the rows chosen so far.
+ * @param size[out] The number of live rows of the chosen column.
+ *
+ * @return The first uncovered column with the fewest live rows like choose_min or -1 if every
+ *         primary column is covered.
  */
-static void uncover_column(struct dlx_solver *dlx, struct dlx_node *column) {
-    for(struct dlx_node *i = column->U; i != column; i = i->U)
-        for(struct dlx_node *j = i->L; j != i; j = j->L)
-            show_v(j), j->C->size++;
-    show_h(column);
-    dlx->column = column;
+static int live_column(struct dlx_solver *dlx, const int *live, int live_count, const uint64_t *covered,
+                       int *size) {
+    int words = dlx_words(dlx->column_count);
+    int *sizes = calloc_s(dlx->column_count, sizeof(*sizes));
+    for(int i = 0; i < live_count; i++)
+        for(int w = 0; w < words; w++)
+            for(uint64_t bits = dlx->rows[live[i]]->row[w]; bits; bits &= bits - 1)
+                sizes[w * 64 + __builtin_ctzll(bits)]++;
+
+    int column = -1;
+    for(int i = 0; i < dlx->primary_count; i++)
+        if(!(covered[i >> 6] >> (i & 63) & 1) && (column < 0 || sizes[i] < sizes[column]))
+            column = i;
+    *size = column < 0 ? 0 : sizes[column];
+    free(sizes);
+    return column;
 }
 
 /**
- * Check if one of the heuristics thinks this branch should be terminated.
+ * Chooses a row, removing the rows which intersect it from the live rows.
+ *
+ * @param dlx[in] The solver whose tree is walked.
+ * @param live[in] The live rows of the node.
+ * @param live_count The number of live rows.
+ * @param covered[in,out] The columns which are covered by the rows chosen so far.
+ * @param r The index of the row which is chosen.
+ * @param next[out] The live rows of the row's node, which must not overlap with live.
  *
- * @param dlx[in] The dlx solver instance which is to be used.
- * @param dlx_data[in] The data which is used by the heuristic.
+ * @return The number of live rows of the row's node.
+ */
+static int live_choose(struct dlx_solver *dlx, const int *live, int live_count, uint64_t *covered, int r,
+                       int *next) {
+    int words = dlx_words(dlx->column_count), next_count = 0;
+    const uint64_t *row = dlx->rows[r]->row;
+    for(int w = 0; w < words; w++)
+        covered[w] |= row[w];
+    for(int i = 0; i < live_count; i++) {
+        const uint64_t *other = dlx->rows[live[i]]->row;
+        bool disjoint = true;
+        for(int w = 0; w < words && disjoint; w++)
+            disjoint = !(row[w] & other[w]);
+        if(disjoint) next[next_count++] = live[i];
+    }
+    return next_count;
+}
+
+/**
+ * @param dlx[in] The solver whose tree is walked.
+ * @param covered[out] The columns covered by the rows chosen so far, which are set to none.
  *
- * @return True iff a heuristic has decided to terminate this branch.
+ * @return The live rows of the root, which has room for those of column_count nodes below it.
  */
-static bool call_heuristics(struct dlx_solver *dlx, void *dlx_data) {
-    for(struct dlx_heuristic *h = dlx->heuristic; h; h = h->next)
-        if(h->callback(dlx_data))
-            return true;
-    return false;
+static int *live_root(struct dlx_solver *dlx, uint64_t *covered) {
+    int *live = malloc_s((size_t) (dlx->column_count + 1) * (dlx->row_count + 1) * sizeof(*live));
+    for(int i = 0; i < dlx->row_count; i++)
+        live[i] = i;
+    memset(covered, 0, dlx_words(dlx->column_count) * sizeof(*covered));
+    return live;
 }
 
 /**
- * Searches the current "sub-tree" for solutions.
+ * Visits the nodes above the depth of the shards like the search and adds a task for each node of
+ * the solver's shard. The columns and rows chosen at each depth are kept in dlx->columns and
+ * dlx->path, which hold the indices of the rows rather than nodes here.
  *
- * @param dlx[in] The instance of the dlx algorithm.
- * @param context[in] The current context storing some important exposed information.
+ * @param dlx[in] The solver whose tasks are to be added.
+ * @param live[in] The live rows of the node, followed by room for those of the nodes below it.
+ * @param live_count The number of live rows.
+ * @param covered[in] The columns which are covered by the rows chosen so far.
+ * @param depth The number of rows which have been chosen so far.
+ * @param number[in,out] The number of nodes which have been assigned to a shard so far.
+ * @param weight The share of the tree below the node, assuming that the branches of each node
+ *               are equally large.
+ * @param share[in,out] The share of the tree which belongs to the solver's shard or NULL if the
+ *                      tasks are to be added instead.
  */
-static void search(struct dlx_solver *dlx, struct dlx_context *context) {
-    if(!dlx->column) {
-        dlx->callback(context);
+static void shard_tasks(struct dlx_solver *dlx, int *live, int live_count, uint64_t *covered, int depth,
+                        int *number, double weight, double *share) {
+    int size, column = depth < dlx->shard_depth ? live_column(dlx, live, live_count, covered, &size) : -1;
+
+    /* The node is at the depth of the shards or a solution. */
+    if(column < 0) {
+        if((*number)++ % dlx->shard_count != dlx->shard_index)
+            return;
+        if(share) {
+            *share += weight;
+            return;
+        }
+        struct dlx_task *task = task_new(depth);
+        for(int i = 0; i < depth; i++)
+            task->path[i].column = dlx->columns[i],
+            task->path[i].row = dlx->path[i];
+        dlx_push_task(dlx, task);
         return;
     }
 
-    struct dlx_solution *s = malloc_s(sizeof(*s)), *p = context->solution;
-    struct dlx_node *column = choose_min(dlx->column);
+    dlx->columns[depth] = column;
+    int words = dlx_words(dlx->column_count), *next = live + live_count;
+    for(int i = 0; i < live_count; i++) {
+        if(!dlx_has(dlx->rows[live[i]], column))
+            continue;
+
+        uint64_t child[words];
+        memcpy(child, covered, sizeof(child));
+        dlx->path[depth] = live[i];
+        int next_count = live_choose(dlx, live, live_count, child, live[i], next);
+        shard_tasks(dlx, next, next_count, child, depth + 1, number, weight / size, share);
+    }
+}
+
+/**
+ * @param dlx[in] The solver whose share of the tree is to be returned.
+ * @return The share of the tree which belongs to the solver's shard or 1 if it searches the whole tree.
+ */
+static double shard_share(struct dlx_solver *dlx) {
+    if(!dlx->shard_count)
+        return 1;
+    uint64_t covered[dlx_words(dlx->column_count)];
+    int *live = live_root(dlx, covered), number = 0;
+    double share = 0;
+    shard_tasks(dlx, live, dlx->row_count, covered, 0, &number, 1, &share);
+    free(live);
+    return share;
+}
+
+/**
+ * Follows a random path down from a node like Knuth's estimator. The rows of each column are tried
+ * with the callbacks and heuristics like the search, and the path continues with one of those
+ * which aren't pruned.
+ *
+ * @param dlx[in] The solver whose tree is walked.
+ * @param dlx_data[in] The data which is passed to the callbacks, the rows above the node have been added.
+ * @param nodes[in] The live rows of the node, followed by room for those of the nodes below it.
+ * @param live_count The number of live rows.
+ * @param covered[in,out] The columns which are covered by the rows above the node, which are
+ *                        covered by those of the path on return.
+ * @param depth The number of rows above the node, which are kept in dlx->path.
+ * @param column The column of the node.
+ * @param first The first row of the column which is tried, the rows before it were searched already.
+ * @param random[in,out] The state of the random paths.
+ *
+ * @return The estimated number of rows which are tried from the node onwards.
+ */
+static double probe(struct dlx_solver *dlx, void *dlx_data, int *nodes, int live_count, uint64_t *covered,
+                    int depth, int column, int first, uint64_t *random) {
+    /* The number of nodes at the depth of the probe if every node had as many branches. */
+    double total = 0, weight = 1;
+    int start = depth;
+    for(int size; column >= 0; column = live_column(dlx, nodes, live_count, covered, &size), first = 0) {
+        /* Try every row of the column like the search and pick one of those which aren't pruned. */
+        int kept = 0, chosen = -1;
+        for(int i = 0; i < live_count; i++) {
+            struct matrix_row *row = dlx->rows[nodes[i]];
+            if(nodes[i] < first || !dlx_has(row, column))
+                continue;
+
+            total += weight;
+            dlx->before(dlx_data, row);
+            bool prune = false;
+            for(struct dlx_heuristic *h = dlx->heuristic; h && !prune; h = h->next)
+                prune = h->callback(dlx_data);
+            dlx->after(dlx_data, row);
+
+            *random ^= *random << 13, *random ^= *random >> 7, *random ^= *random << 17;
+            if(!prune && *random % ++kept == 0)
+                chosen = nodes[i];
+        }
+        if(!kept) break;
+
+        weight *= kept;
+        dlx->path[depth++] = chosen;
+        dlx->before(dlx_data, dlx->rows[chosen]);
+        int *next = nodes + live_count;
+        live_count = live_choose(dlx, nodes, live_count, covered, chosen, next);
+        nodes = next;
+    }
+    while(depth > start)
+        dlx->after(dlx_data, dlx->rows[dlx->path[--depth]]);
+    return total;
+}
+
+/**
+ * Estimates the rows which are left in a task of a paused search, which are the siblings after
+ * the path from the base of the task onwards and everything below them.
+ *
+ * @param dlx[in] The solver whose task is to be estimated.
+ * @param dlx_data[in] The data which is passed to the callbacks.
+ * @param task[in] The task which is to be estimated.
+ * @param live[in] The live rows of the root, followed by room for those of the nodes below it.
+ * @param probes The number of random paths which are followed from each depth of the task.
+ * @param random[in,out] The state of the random paths.
+ *
+ * @return The estimated number of rows which are left in the task.
+ */
+static double estimate_task(struct dlx_solver *dlx, void *dlx_data, const struct dlx_task *task, int *live,
+                            int probes, uint64_t *random) {
+    int words = dlx_words(dlx->column_count), *nodes = live, live_count = dlx->row_count;
+    uint64_t covered[words], branch[words];
+    memset(covered, 0, sizeof(covered));
+    double total = 0;
+    int depth = 0;
+    for(; depth <= task->depth; depth++) {
+        int column = task->path[depth].column, row = task->path[depth].row;
+        if(depth >= task->base) {
+            /* The row at the depth of the task hasn't been tried yet, those above it have been. */
+            int first = row < 0 ? 0 : depth == task->depth ? row : row + 1;
+            for(int p = 0; p < probes; p++) {
+                memcpy(branch, covered, sizeof(branch));
+                total += probe(dlx, dlx_data, nodes, live_count, branch, depth, column, first, random);
+            }
+        }
+        if(depth == task->depth || row < 0)
+            break;
+
+        dlx->path[depth] = row;
+        dlx->before(dlx_data, dlx->rows[row]);
+        int *next = nodes + live_count;
+        live_count = live_choose(dlx, nodes, live_count, covered, row, next);
+        nodes = next;
+    }
+    while(depth > 0)
+        dlx->after(dlx_data, dlx->rows[dlx->path[--depth]]);
+    return probes ? total / probes : 0;
+}
+
+double dlx_estimate(struct dlx_solver *dlx, void *dlx_data, int probes, uint64_t seed) {
+    uint64_t covered[dlx_words(dlx->column_count)], random = seed ? seed : 1;
+    int *live = live_root(dlx, covered), size;
+    double total = 0;
+    if(!dlx->task_count) {
+        for(int p = 0; p < probes; p++) {
+            memset(covered, 0, sizeof(covered));
+            int column = live_column(dlx, live, dlx->row_count, covered, &size);
+            total += probe(dlx, dlx_data, live, dlx->row_count, covered, 0, column, 0, &random);
+        }
+        total = probes ? total / probes : 0;
+    } else {
+        /* Spread the paths over the tasks, each of which gets at least one. */
+        int task_probes = (probes + dlx->task_count - 1) / dlx->task_count;
+        for(int t = 0; t < dlx->task_count; t++)
+            total += estimate_task(dlx, dlx_data, dlx->tasks[t], live, task_probes, &random);
+    }
+    free(live);
+    return total;
+}
+
+double dlx_remaining(struct dlx_solver *dlx) {
+    uint64_t covered[dlx_words(dlx->column_count)];
+    int *live = live_root(dlx, covered);
+    double remaining = 0;
+    for(int t = 0; t < dlx->task_count; t++) {
+        const struct dlx_task *task = dlx->tasks[t];
+        int *nodes = live, live_count = dlx->row_count;
+        memset(covered, 0, sizeof(covered));
+        /* The share of the tree below the node at depth i. */
+        double weight = 1;
+        for(int i = 0; i <= task->depth; i++) {
+            if(task->path[i].row < 0) {
+                remaining += weight;
+                break;
+            }
+
+            /* Find the position of the row among the rows of its column. */
+            int column = task->path[i].column, size = 0, index = 0;
+            for(int j = 0; j < live_count; j++) {
+                if(!dlx_has(dlx->rows[nodes[j]], column)) continue;
+                if(nodes[j] == task->path[i].row) index = size;
+                size++;
+            }
+            if(i == task->depth) {
+                /* The row at the depth of the task hasn't been tried yet. */
+                remaining += weight * (size - index) / size;
+                break;
+            }
+            /* The rows above the base of the task have no siblings to search. */
+            if(i >= task->base)
+                remaining += weight * (size - index - 1) / size;
+
+            weight /= size;
+            int *next = nodes + live_count;
+            live_count = live_choose(dlx, nodes, live_count, covered, task->path[i].row, next);
+            nodes = next;
+        }
+    }
+    free(live);
+    return remaining / shard_share(dlx);
+}
+
+double dlx_bound(struct dlx_solver *dlx, void *dlx_data, dlx_bound_callback bound) {
+    double result = -INFINITY;
+    for(int t = 0; t < dlx->task_count; t++) {
+        const struct dlx_task *task = dlx->tasks[t];
+        for(int i = 0; i < task->base; i++)
+            dlx->before(dlx_data, dlx->rows[task->path[i].row]);
+        double value = bound(dlx_data);
+        if(value > result) result = value;
+        for(int i = task->base - 1; i >= 0; i--)
+            dlx->after(dlx_data, dlx->rows[task->path[i].row]);
+    }
+    return result;
+}
+
+/**
+ * Takes the tasks from which the solver is to be resumed, starting with the whole tree or the
+ * solver's shard of it if there are non.
+ *
+ * @param dlx[in] The solver whose tasks are to be taken.
+ * @param count[out] The number of tasks which were taken.
+ *
+ * @return The tasks which are to be searched.
+ */
+static struct dlx_task **take_tasks(struct dlx_solver *dlx, int *count) {
+    if(!dlx->task_count && dlx->shard_count) {
+        uint64_t covered[dlx_words(dlx->column_count)];
+        int *live = live_root(dlx, covered), number = 0;
+        shard_tasks(dlx, live, dlx->row_count, covered, 0, &number, 1, NULL);
+        free(live);
+    } else if(!dlx->task_count) {
+        dlx_push_task(dlx, task_new(0));
+    }
+    DLX_BUCKET(if(dlx->backend == DLX_LINKS && !dlx->buckets) buckets_build(dlx));
+
+    struct dlx_task **tasks = dlx->tasks;
+    *count = dlx->task_count;
+    dlx->tasks = NULL;
+    dlx->task_count = dlx->task_capacity = 0;
+    atomic_store(dlx->stop, false);
+    return tasks;
+}
+
+bool dlx_solve(struct dlx_solver *dlx, void *dlx_data) {
+    int count;
+    struct dlx_task **tasks = take_tasks(dlx, &count);
+
+    bool done = true;
+    for(int i = 0; i < count; i++) {
+        /* Keep the tasks which haven't been started if the search was paused. */
+        if(!done) {
+            dlx_push_task(dlx, tasks[i]);
+            continue;
+        }
+        switch(dlx->backend) {
+            case DLX_BITBOARD:
+                done = bitboard_solve(dlx, dlx_data, tasks[i]);
+                break;
+            case DLX_SPARSE:
+                done = sparse_solve(dlx, dlx_data, tasks[i]);
+                break;
+            default:
+                done = dlx->search(dlx, dlx_data, tasks[i]);
+        }
+        free(tasks[i]);
+    }
+    free(tasks);
+    return done;
+}
+
+/**
+ * @param dlx[in] The solver which is to be copied.
+ * @return A solver sharing the rows, callbacks and heuristics of the given solver with its own matrix.
+ */
+static struct dlx_solver *dlx_clone(struct dlx_solver *dlx) {
+    struct dlx_solver *clone = malloc_s(sizeof(*clone));
+    *clone = *dlx;
+    clone->arena = NULL;
+    arena_resize(clone, dlx->node_capacity);
+    memcpy(clone->arena, dlx->arena, (dlx->column_count + 6 * (size_t) dlx->node_capacity) * sizeof(*dlx->arena));
+#ifdef DLX_BUCKETS
+    clone->buckets = malloc_s(dlx->bucket_count * dlx->bucket_words * sizeof(*clone->buckets));
+    memcpy(clone->buckets, dlx->buckets, dlx->bucket_count * dlx->bucket_words * sizeof(*clone->buckets));
+#endif
+    clone->columns = malloc_s((dlx->column_count + 1) * sizeof(*clone->columns));
+    clone->path = malloc_s((dlx->column_count + 1) * sizeof(*clone->path));
+    clone->solution = malloc_s((dlx->column_count + 1) * sizeof(*clone->solution));
+    clone->tasks = NULL;
+    clone->task_count = clone->task_capacity = 0;
+    DLX_STAT(clone->stats = calloc_s(dlx->column_count + 1, sizeof(*clone->stats)));
+    return clone;
+}
+
+#ifdef DLX_STATS
+/**
+ * Adds the statistics collected by a copy of the solver to the solver's statistics.
+ *
+ * @param dlx[in] The solver whose statistics are to be updated.
+ * @param clone[in] The copy whose statistics are to be added.
+ */
+static void stats_add(struct dlx_solver *dlx, struct dlx_solver *clone) {
+    for(int i = 0; i <= dlx->column_count; i++) {
+        struct dlx_stats *a = &dlx->stats[i], *b = &clone->stats[i];
+        a->nodes += b->nodes, a->rows += b->rows, a->links += b->links;
+        for(int j = 0; j < DLX_STATS_HEURISTICS; j++)
+            a->heuristics[j].calls += b->heuristics[j].calls,
+            a->heuristics[j].prunes += b->heuristics[j].prunes,
+            a->heuristics[j].nanos += b->heuristics[j].nanos;
+    }
+}
+#endif
+
+/**
+ * Frees a solver which was created by dlx_clone.
+ * @param clone[in] The copy which is to be freed.
+ */
+static void dlx_clone_free(struct dlx_solver *clone) {
+    free(clone->arena);
+    DLX_BUCKET(free(clone->buckets));
+    free(clone->columns);
+    free(clone->path);
+    free(clone->solution);
+    free(clone->tasks);
+    DLX_STAT(free(clone->stats));
+    free(clone);
+}
+
+/**
+ * @param worker[in] The worker which is looking for a task.
+ * @return A task taken from another worker's deque or NULL if all of them are empty.
+ */
+static struct dlx_task *steal(struct dlx_worker *worker) {
+    struct dlx_pool *pool = worker->pool;
+    for(int i = 1; i < pool->worker_count; i++) {
+        struct dlx_worker *victim = &pool->workers[(worker->id + i) % pool->worker_count];
+        struct dlx_task *task = deque_take(&victim->deque, true);
+        if(task) return task;
+    }
+    return NULL;
+}
+
+/**
+ * The main loop of each worker thread.
+ * @param arg[in] The worker which is to be run.
+ */
+static void *worker_run(void *arg) {
+    struct dlx_worker *worker = arg;
+    struct dlx_pool *pool = worker->pool;
+    bool idle = false;
+    while(!should_stop(worker->dlx)) {
+        struct dlx_task *task = deque_take(&worker->deque, false);
+        if(!task) task = steal(worker);
+        if(!task) {
+            if(!atomic_load(&pool->pending))
+                break;
+            if(!idle) atomic_fetch_add(&pool->idle, 1), idle = true;
+            sched_yield();
+            continue;
+        }
+        if(idle) atomic_fetch_sub(&pool->idle, 1), idle = false;
+
+        worker->dlx->search(worker->dlx, worker->dlx_data, task);
+        free(task);
+        atomic_fetch_sub(&pool->pending, 1);
+    }
+    return NULL;
+}
+
+bool dlx_solve_parallel(struct dlx_solver *dlx, void *dlx_data[], int thread_count) {
+    if(dlx->backend != DLX_LINKS)
+        return dlx_solve(dlx, dlx_data[0]);
+
+    int count;
+    struct dlx_task **tasks = take_tasks(dlx, &count);
+
+    struct dlx_pool pool = { .worker_count = thread_count };
+    pool.workers = calloc_s(thread_count, sizeof(*pool.workers));
+    atomic_init(&pool.pending, count);
+    atomic_init(&pool.idle, 0);
+
+    for(int i = 0; i < thread_count; i++) {
+        struct dlx_worker *worker = &pool.workers[i];
+        worker->dlx = i ? dlx_clone(dlx) : dlx;
+        worker->dlx->worker = worker;
+        worker->pool = &pool;
+        worker->dlx_data = dlx_data[i];
+        worker->id = i;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        atomic_init(&worker->deque.size, 0);
+    }
+
+    /* The first worker starts out with all of the tasks. */
+    for(int i = count - 1; i >= 0; i--)
+        deque_push(&pool.workers[0].deque, tasks[i]);
+    free(tasks);
+
+    for(int i = 1; i < thread_count; i++)
+        if(pthread_create(&pool.workers[i].thread, NULL, worker_run, &pool.workers[i]))
+            exit(1);
+    worker_run(&pool.workers[0]);
+
+    for(int i = 0; i < thread_count; i++) {
+        struct dlx_worker *worker = &pool.workers[i];
+        if(i) {
+            pthread_join(worker->thread, NULL);
+            /* Collect the tasks which were paused by this worker. */
+            for(int j = 0; j < worker->dlx->task_count; j++)
+                dlx_push_task(dlx, worker->dlx->tasks[j]);
+            DLX_STAT(stats_add(dlx, worker->dlx));
+            dlx_clone_free(worker->dlx);
+        }
 
-    cover_column(dlx, column);
-    for(struct dlx_node *r = column->D; r != column; r = r->D) {
-        dlx->before(context->dlx_data, r);
+        /* Keep the tasks which haven't been started. */
+        for(struct dlx_task *task; (task = deque_take(&worker->deque, true)); )
+            dlx_push_task(dlx, task);
+        pthread_mutex_destroy(&worker->deque.lock);
+        free(worker->deque.tasks);
+    }
+    dlx->worker = NULL;
+    free(pool.workers);
+    return !dlx->task_count;
+}
 
-        /* Construct and update the current solution. */
-        s->row = r->row, s->next = p, context->solution = s;
-        for(struct dlx_node *j = r->R; j != r; j = j->R)
-            cover_column(dlx, j->C);
+/* Identifies the files written by dlx_save. */
+static const int32_t DLX_MAGIC = 0x584c44, DLX_VERSION = 1;
+
+bool dlx_save(struct dlx_solver *dlx, FILE *file) {
+    int32_t header[] = { DLX_MAGIC, DLX_VERSION, dlx->column_count, dlx->row_count, dlx->task_count };
+    if(fwrite(header, sizeof(header), 1, file) != 1)
+        return false;
+
+    for(int i = 0; i < dlx->task_count; i++) {
+        struct dlx_task *task = dlx->tasks[i];
+        int32_t entry[] = { task->base, task->depth };
+        if(fwrite(entry, sizeof(entry), 1, file) != 1)
+            return false;
+        for(int j = 0; j <= task->depth; j++) {
+            int32_t step[] = { task->path[j].column, task->path[j].row };
+            if(fwrite(step, sizeof(step), 1, file) != 1)
+                return false;
+        }
+    }
+    return true;
+}
 
-        if(!call_heuristics(dlx, context->dlx_data))
-            search(dlx, context);
+/**
+ * Replays the path of the task against the matrix, each of its rows has to be live once the rows
+ * before it are covered, so that the search finds it in the list of its column.
+ *
+ * @param dlx[in] The solver for which the task was saved.
+ * @param task[in] The task which is to be validated.
+ * @return True iff the path of the task can be resumed on the solver's matrix.
+ */
+static bool task_valid(struct dlx_solver *dlx, struct dlx_task *task) {
+    if(task->base < 0 || task->base > task->depth)
+        return false;
+
+    int words = dlx_words(dlx->column_count);
+    uint64_t covered[words];
+    memset(covered, 0, sizeof(covered));
+    for(int i = 0; i <= task->depth; i++) {
+        int column = task->path[i].column, row = task->path[i].row;
+        if(column < 0 || column >= dlx->primary_count || covered[column / 64] >> (column % 64) & 1)
+            return false;
+        /* Only the node at depth may not have been entered yet. */
+        if(row < 0 && i == task->depth && task->base == task->depth)
+            continue;
+        if(row < 0 || row >= dlx->row_count || !dlx_has(dlx->rows[row], column))
+            return false;
+
+        for(int w = 0; w < words; w++) {
+            if(covered[w] & dlx->rows[row]->row[w])
+                return false;
+            covered[w] |= dlx->rows[row]->row[w];
+        }
+    }
+    return true;
+}
 
-        for(struct dlx_node *j = r->L; j != r; j = j->L)
-            uncover_column(dlx, j->C);
+bool dlx_load(struct dlx_solver *dlx, FILE *file) {
+    int32_t header[5];
+    if(fread(header, sizeof(header), 1, file) != 1 || header[0] != DLX_MAGIC ||
+       header[1] != DLX_VERSION || header[2] != dlx->column_count || header[3] != dlx->row_count ||
+       header[4] < 0)
+        return false;
+
+    /* Read every task before replacing the tasks of the solver, so that a bad file changes nothing. */
+    struct dlx_task **tasks = malloc_s((header[4] + 1) * sizeof(*tasks));
+    bool valid = true;
+    int count = 0;
+    while(valid && count < header[4]) {
+        int32_t entry[2];
+        if(fread(entry, sizeof(entry), 1, file) != 1 || entry[1] < 0 || entry[1] >= dlx->column_count) {
+            valid = false;
+            break;
+        }
 
-        dlx->after(context->dlx_data, r);
+        struct dlx_task *task = tasks[count++] = task_new(entry[1]);
+        task->base = entry[0];
+        for(int j = 0; j <= task->depth && valid; j++) {
+            int32_t step[2];
+            valid = fread(step, sizeof(step), 1, file) == 1;
+            task->path[j].column = step[0], task->path[j].row = step[1];
+        }
+        valid = valid && task_valid(dlx, task);
     }
 
-    uncover_column(dlx, column);
-    free(s);
+    if(valid) {
+        dlx_reset(dlx);
+        for(int i = 0; i < count; i++)
+            dlx_push_task(dlx, tasks[i]);
+    } else {
+        for(int i = 0; i < count; i++)
+            free(tasks[i]);
+    }
+    free(tasks);
+    return valid;
 }
 
-void dlx_solve(struct dlx_solver *dlx, void *dlx_data) {
-    struct dlx_context *context = calloc_s(1, sizeof(*context));
-    context->dlx_data = dlx_data;
+const struct dlx_stats *dlx_get_stats(struct dlx_solver *dlx, int *depth_count) {
+#ifdef DLX_STATS
+    *depth_count = dlx->column_count + 1;
+    return dlx->stats;
+#else
+    (void) dlx;
+    *depth_count = 0;
+    return NULL;
+#endif
+}
 
-    search(dlx, context);
-    free(context);
+bool dlx_write_stats(struct dlx_solver *dlx, FILE *file, enum dlx_stats_format format) {
+    int depth_count;
+    const struct dlx_stats *stats = dlx_get_stats(dlx, &depth_count);
+    if(!stats) return false;
+
+    int heuristic_count = dlx->heuristic_count < DLX_STATS_HEURISTICS ?
+        dlx->heuristic_count : DLX_STATS_HEURISTICS;
+    /* Only write the depths which were reached. */
+    while(depth_count > 0 && !stats[depth_count - 1].nodes && !stats[depth_count - 1].rows)
+        depth_count--;
+
+    if(format == DLX_STATS_CSV) {
+        fprintf(file, "depth,nodes,rows,links");
+        for(int j = 0; j < heuristic_count; j++)
+            fprintf(file, ",calls_%d,prunes_%d,nanos_%d", j, j, j);
+        fprintf(file, "\n");
+        for(int i = 0; i < depth_count; i++) {
+            fprintf(file, "%d,%llu,%llu,%llu", i, (unsigned long long) stats[i].nodes,
+                    (unsigned long long) stats[i].rows, (unsigned long long) stats[i].links);
+            for(int j = 0; j < heuristic_count; j++) {
+                const struct dlx_heuristic_stats *h = &stats[i].heuristics[j];
+                fprintf(file, ",%llu,%llu,%llu", (unsigned long long) h->calls,
+                        (unsigned long long) h->prunes, (unsigned long long) h->nanos);
+            }
+            fprintf(file, "\n");
+        }
+    } else {
+        fprintf(file, "{\"depths\": [");
+        for(int i = 0; i < depth_count; i++) {
+            fprintf(file, "%s\n  {\"depth\": %d, \"nodes\": %llu, \"rows\": %llu, \"links\": %llu, \"heuristics\": [",
+                    i ? "," : "", i, (unsigned long long) stats[i].nodes,
+                    (unsigned long long) stats[i].rows, (unsigned long long) stats[i].links);
+            for(int j = 0; j < heuristic_count; j++) {
+                const struct dlx_heuristic_stats *h = &stats[i].heuristics[j];
+                fprintf(file, "%s{\"calls\": %llu, \"prunes\": %llu, \"nanos\": %llu}",
+                        j ? ", " : "", (unsigned long long) h->calls,
+                        (unsigned long long) h->prunes, (unsigned long long) h->nanos);
+            }
+            fprintf(file, "]}");
+        }
+        fprintf(file, "\n]}\n");
+    }
+    return !ferror(file);
 }
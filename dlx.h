@@ -18,40 +18,101 @@
 #ifndef DLX_H
 #define DLX_H
 
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 struct dlx_solver;
-struct dlx_node {
-    union {
-        struct { int size, col_id; };
-        struct { struct dlx_node *C; struct matrix_row *row; };
-    };
-    struct dlx_node *U, *R, *D, *L;
+struct dlx_task;
+
+/* The engines which may be used to solve the exact cover problem. */
+enum dlx_backend {
+    /* Knuth's dancing links. */
+    DLX_LINKS,
+    /* Rows stored as column masks, limited to 128 columns. */
+    DLX_BITBOARD,
+    /*
+     * Knuth's sparse sets, which delete the options of an item by swapping them within flat arrays.
+     * Unlike Knuth's XCC there are no colour columns, a row only records which columns it covers.
+     */
+    DLX_SPARSE
 };
 
 /* A row in the cover matrix. */
 struct matrix_row {
-    int *row;
+    /* The columns of the row as a bitset of dlx_words(column_count) words. */
+    uint64_t *row;
     void *row_data;
     struct matrix_row *prev, *next;
 };
 
+/**
+ * @param column_count The number of columns in the matrix.
+ * @return The number of words needed to store the columns of a row.
+ */
+static inline int dlx_words(int column_count) {
+    return (column_count + 63) / 64;
+}
+
+/**
+ * @param row[in] The row which is to be checked.
+ * @param column The column which is to be checked.
+ *
+ * @return True iff the row contains the column.
+ */
+static inline bool dlx_has(const struct matrix_row *row, int column) {
+    return (row->row[column >> 6] >> (column & 63)) & 1;
+}
+
+/**
+ * @param row[in,out] The row to which the column is to be added.
+ * @param column The column which is to be added.
+ */
+static inline void dlx_set(struct matrix_row *row, int column) {
+    row->row[column >> 6] |= 1llu << (column & 63);
+}
+
 /* The solution returned by the solver. */
 struct dlx_solution {
     struct matrix_row *row;
     struct dlx_solution *next;
 };
 
+/* The maximum number of heuristics for which statistics are collected. */
+#define DLX_STATS_HEURISTICS 8
+
+/* The statistics collected for a heuristic at one depth of the search. */
+struct dlx_heuristic_stats {
+    /* The number of times the heuristic was called and returned true. */
+    uint64_t calls, prunes;
+    /* The total time spent in the heuristic. */
+    uint64_t nanos;
+};
+
+/* The statistics collected at one depth of the search when compiled with DLX_STATS. */
+struct dlx_stats {
+    /* The number of nodes which were expanded and rows which were tried. */
+    uint64_t nodes, rows;
+    /* The number of nodes which were unlinked by covering columns. */
+    uint64_t links;
+    /* Indexed by the order in which the heuristics were added. */
+    struct dlx_heuristic_stats heuristics[DLX_STATS_HEURISTICS];
+};
+
+/* The formats in which the statistics may be written. */
+enum dlx_stats_format { DLX_STATS_CSV, DLX_STATS_JSON };
+
 /* The context used by the solver. */
 struct dlx_context {
     struct dlx_solution *solution;
     void *dlx_data;
 };
 
-typedef void (*dlx_solution_callback)(struct dlx_context *context);
-typedef void (*dlx_data_callback)(void *dlx_data, struct dlx_node *row);
+typedef bool (*dlx_solution_callback)(struct dlx_context *context);
+typedef void (*dlx_data_callback)(void *dlx_data, struct matrix_row *row);
 typedef bool (*dlx_heuristic_callback)(void *dlx_data);
+typedef bool (*dlx_search_callback)(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task);
+typedef double (*dlx_bound_callback)(void *dlx_data);
 
 /**
  * @param column_count The number of columns in the matrix.
@@ -59,21 +120,41 @@ typedef bool (*dlx_heuristic_callback)(void *dlx_data);
  */
 struct dlx_solver *dlx_new(int column_count);
 
+/**
+ * @param column_count The number of columns in the matrix.
+ * @param backend The engine which is to be used, the bitboard falls back to dancing links if the
+ *                matrix has more than 128 columns.
+ * @return A new instance of the dlx solver.
+ */
+struct dlx_solver *dlx_new_backend(int column_count, enum dlx_backend backend);
+
 /**
  * @param dlx[in] The instance of the solver which is to be freed.
  */
 void dlx_free(struct dlx_solver *dlx);
 
+/**
+ * Makes the last columns secondary, which are covered at most once rather than exactly once. This
+ * must be called before the first search. Secondary columns can't be coloured, so rows sharing one
+ * always conflict.
+ *
+ * @param dlx[in] The solver instance whose columns are to be changed.
+ * @param count The number of secondary columns.
+ */
+void dlx_set_secondary(struct dlx_solver *dlx, int count);
+
 /**
  * Inserts the given row into the matrix.
- * @param row[in] The row vector.
- * @param count The size of the vector.
+ *
+ * @param dlx[in] The solver instance into which the row is to be inserted.
+ * @param row[in] The row whose bitset has a bit for each of the matrix's columns.
  */
 void dlx_row(struct dlx_solver *dlx, struct matrix_row *row);
 
 /**
  * Adds a callback to the solver. <i>NOTE:</i> that solution instances will eventually be
- * overridden and must therefore be copied if they are to remain in memory.
+ * overridden and must therefore be copied if they are to remain in memory. The search is paused
+ * like by dlx_stop once the callback returns true, for example because the solution is good enough.
  *
  * @param dlx[in] The solver instance to which the callback should be added.
  * @param callback[in] The callback which is supposed to be added to the solver.
@@ -97,11 +178,148 @@ void dlx_set_ba(struct dlx_solver *dlx, dlx_data_callback before, dlx_data_callb
  */
 void dlx_add_heuristic(struct dlx_solver *dlx, dlx_heuristic_callback callback);
 
+/**
+ * Replaces the search used by dancing links with one instantiated from dlx_search.h, which calls
+ * a fixed set of callbacks and heuristics directly. The callbacks and heuristics which were added
+ * to the solver are still used by the other backends.
+ *
+ * @param dlx[in] The solver instance whose search is to be replaced.
+ * @param search[in] The instantiated search or NULL to restore the default one.
+ */
+void dlx_set_search(struct dlx_solver *dlx, dlx_search_callback search);
+
+/**
+ * Restricts the searches starting from the whole tree to a slice of it, so that several processes
+ * can split the tree between them. The nodes at the given depth, or the solutions above it, are
+ * numbered in the order in which the search visits them and only those whose number is the index
+ * modulo the count are searched.
+ *
+ * @param dlx[in] The solver instance whose searches are to be restricted.
+ * @param index The index of the slice which is to be searched.
+ * @param count The number of slices or 1 to search the whole tree.
+ * @param depth The depth of the nodes which are split between the slices.
+ */
+void dlx_set_shard(struct dlx_solver *dlx, int index, int count, int depth);
+
 /**
  * Lists all solutions to the exact cover problem calling the callback whenever a solution is found.
+ * If the previous search was paused it is resumed from where it stopped.
+ *
+ * @param dlx[in] The instance of the solver which is to be used.
+ * @param dlx_data[in] Some additional data which may be utilized by the heuristics or NULL if non is needed.
+ *
+ * @return True iff the search was completed, false if it was paused using dlx_stop.
+ */
+bool dlx_solve(struct dlx_solver *dlx, void *dlx_data);
+
+/**
+ * Lists all solutions like dlx_solve but splits the search tree between several threads. Each
+ * thread explores its subtrees on its own copy of the matrix and hands branches off to idle
+ * threads. <i>NOTE:</i> that the callbacks are invoked concurrently and must synchronize any
+ * state shared between the entries of dlx_data. Only dancing links support this, the other
+ * backends search sequentially using the first entry.
+ *
  * @param dlx[in] The instance of the solver which is to be used.
+ * @param dlx_data[in] One entry of additional data for each of the threads.
+ * @param thread_count The number of threads which are to be used.
+ *
+ * @return True iff the search was completed, false if it was paused using dlx_stop.
+ */
+bool dlx_solve_parallel(struct dlx_solver *dlx, void *dlx_data[], int thread_count);
+
+/**
+ * Pauses the running search, which then restores the matrix and returns from dlx_solve. This may
+ * be called from a signal handler or another thread.
+ *
+ * @param dlx[in] The instance of the solver whose search is to be paused.
+ */
+void dlx_stop(struct dlx_solver *dlx);
+
+/**
+ * Discards the branches of a paused search, so that the next search starts from the whole tree.
+ *
+ * @param dlx[in] The instance of the solver whose search is to be discarded.
+ */
+void dlx_reset(struct dlx_solver *dlx);
+
+/**
+ * Estimates the number of rows which a search of the whole tree tries, by following random paths
+ * from the root like Knuth's estimator. The rows are tried with the callbacks and heuristics which
+ * were added to the solver, which therefore see the same branches as the search, except for the
+ * solution callback which isn't called. The paths of a paused search start from the branches of
+ * its tasks instead, which estimates the rows which are left.
+ *
+ * @param dlx[in] The instance of the solver whose tree is to be estimated, which must not be searching.
  * @param dlx_data[in] Some additional data which may be utilized by the heuristics or NULL if non is needed.
+ * @param probes The number of random paths which are followed, spread over the tasks of a paused search.
+ * @param seed The seed of the random paths.
+ *
+ * @return The average estimate of the paths, summed over the tasks.
+ */
+double dlx_estimate(struct dlx_solver *dlx, void *dlx_data, int probes, uint64_t seed);
+
+/**
+ * Estimates how much of the tree is left for a paused search, assuming that the branches of each
+ * node are equally large. This is the share of the branches rather than of the rows, for which see
+ * dlx_estimate.
+ *
+ * @param dlx[in] The instance of the solver whose search was paused.
+ * @return The share of the solver's slice of the tree, see dlx_set_shard, which hasn't been searched.
+ */
+double dlx_remaining(struct dlx_solver *dlx);
+
+/**
+ * Bounds what a paused search may still find. The rows above the base of each of its branches are
+ * added to the data with the callbacks of the solver, which then bound the whole branch.
+ *
+ * @param dlx[in] The instance of the solver whose search was paused.
+ * @param dlx_data[in] The additional data of the callbacks, which is restored afterwards.
+ * @param bound[in] Returns an upper bound of the branches below the rows added to the data.
+ *
+ * @return The highest bound of any branch or -INFINITY if the search isn't paused.
+ */
+double dlx_bound(struct dlx_solver *dlx, void *dlx_data, dlx_bound_callback bound);
+
+/**
+ * Writes the branches from which a paused search is to be resumed.
+ *
+ * @param dlx[in] The instance of the solver whose search was paused.
+ * @param file[in] The file which is to be written to.
+ *
+ * @return True iff the branches were written successfully.
+ */
+bool dlx_save(struct dlx_solver *dlx, FILE *file);
+
+/**
+ * Reads branches written by dlx_save for a solver with the same rows, the next search is then
+ * resumed from those branches.
+ *
+ * @param dlx[in] The instance of the solver which is to be resumed.
+ * @param file[in] The file which is to be read from.
+ *
+ * @return True iff the branches were read successfully.
+ */
+bool dlx_load(struct dlx_solver *dlx, FILE *file);
+
+/**
+ * @param dlx[in] The instance of the solver whose statistics are to be returned.
+ * @param depth_count[out] The number of depths for which statistics are collected.
+ *
+ * @return The statistics of each depth of the searches so far or NULL if the solver was compiled
+ *         without DLX_STATS.
+ */
+const struct dlx_stats *dlx_get_stats(struct dlx_solver *dlx, int *depth_count);
+
+/**
+ * Writes the statistics of each depth which was reached by the searches so far.
+ *
+ * @param dlx[in] The instance of the solver whose statistics are to be written.
+ * @param file[in] The file which is to be written to.
+ * @param format The format in which the statistics are to be written.
+ *
+ * @return True iff the statistics were written, false if the solver was compiled without
+ *         DLX_STATS or writing failed.
  */
-void dlx_solve(struct dlx_solver *dlx, void *dlx_data);
+bool dlx_write_stats(struct dlx_solver *dlx, FILE *file, enum dlx_stats_format format);
 
 #endif /* DLX_H */
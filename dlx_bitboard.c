@@ -0,0 +1,232 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dlx.h"
+#include "dlx_internal.h"
+
+#include <string.h>
+
+#include "globals.h"
+
+/* A set of up to 128 columns. */
+struct bb_mask {
+    uint64_t w[2];
+};
+
+/* The matrix stored as column masks for each row and row sets for each column. */
+struct bitboard {
+    struct dlx_solver *dlx;
+    struct dlx_context context;
+    /* The number of rows and primary columns of the solver when the matrix was built. */
+    int row_count, primary_count;
+
+    /* The number of words needed to store a set of rows. */
+    int words;
+    struct bb_mask *masks, full;
+    /* The set of rows containing each of the columns. */
+    uint64_t *candidates;
+    /* The set of rows which are still available at each depth. */
+    uint64_t *live;
+
+    /* The task whose path is being replayed or NULL once the search has left it. */
+    const struct dlx_task *task;
+    int base;
+};
+
+/**
+ * @param dlx[in] The solver whose rows are to be converted.
+ * @return The matrix of the solver as a bitboard with every row being available.
+ */
+static struct bitboard *bitboard_new(struct dlx_solver *dlx) {
+    struct bitboard *bb = calloc_s(1, sizeof(*bb));
+    int words = bb->words = (dlx->row_count + 63) / 64;
+    bb->dlx = dlx;
+    bb->row_count = dlx->row_count, bb->primary_count = dlx->primary_count;
+    bb->masks = calloc_s(dlx->row_count, sizeof(*bb->masks));
+    bb->candidates = calloc_s((size_t) dlx->column_count * words, sizeof(uint64_t));
+    bb->live = calloc_s((size_t) (dlx->column_count + 1) * words, sizeof(uint64_t));
+
+    /* Only the primary columns have to be covered. */
+    memset(&bb->full, 0, sizeof(bb->full));
+    for(int i = 0; i < dlx->primary_count; i++)
+        bb->full.w[i >> 6] |= 1ull << (i & 63);
+
+    for(int r = 0; r < dlx->row_count; r++) {
+        for(int w = 0; w < dlx_words(dlx->column_count); w++) {
+            bb->masks[r].w[w] = dlx->rows[r]->row[w];
+            for(uint64_t bits = bb->masks[r].w[w]; bits; bits &= bits - 1) {
+                int i = w * 64 + __builtin_ctzll(bits);
+                bb->candidates[i * words + (r >> 6)] |= 1ull << (r & 63);
+            }
+        }
+        bb->live[r >> 6] |= 1ull << (r & 63);
+    }
+    return bb;
+}
+
+void bitboard_free(struct bitboard *bb) {
+    free(bb->masks);
+    free(bb->candidates);
+    free(bb->live);
+    free(bb);
+}
+
+/**
+ * @param bb[in] The bitboard which is being searched.
+ * @param covered The columns which have been covered.
+ * @param live[in] The rows which are still available.
+ *
+ * @return The uncovered column contained in the least number of available rows.
+ */
+static int choose_column(struct bitboard *bb, struct bb_mask covered, const uint64_t *live) {
+    int min = -1, min_size = 0;
+    for(int w = 0; w < 2; w++) {
+        for(uint64_t bits = bb->full.w[w] & ~covered.w[w]; bits; bits &= bits - 1) {
+            int column = (w << 6) + __builtin_ctzll(bits);
+            const uint64_t *candidates = &bb->candidates[column * bb->words];
+
+            int size = 0;
+            for(int i = 0; i < bb->words; i++)
+                size += __builtin_popcountll(live[i] & candidates[i]);
+            if(min < 0 || size < min_size) {
+                min = column, min_size = size;
+                /* A column can't have less than one row, unless the branch is dead. */
+                if(size <= 1) return min;
+            }
+        }
+    }
+    return min;
+}
+
+/**
+ * Removes all of the rows intersecting the given row from the available rows.
+ *
+ * @param bb[in] The bitboard which is being searched.
+ * @param next[out] The rows which remain available after choosing the row.
+ * @param live[in] The rows which are currently available.
+ * @param mask The columns of the row which was chosen.
+ */
+static void cover_row(struct bitboard *bb, uint64_t *next, const uint64_t *live, struct bb_mask mask) {
+    memcpy(next, live, bb->words * sizeof(*next));
+    for(int w = 0; w < 2; w++) {
+        for(uint64_t bits = mask.w[w]; bits; bits &= bits - 1) {
+            const uint64_t *candidates = &bb->candidates[((w << 6) + __builtin_ctzll(bits)) * bb->words];
+            for(int i = 0; i < bb->words; i++)
+                next[i] &= ~candidates[i];
+        }
+    }
+}
+
+/**
+ * Adds the remainder of the current task to the solver's tasks.
+ *
+ * @param bb[in] The bitboard which is being searched.
+ * @param depth The number of rows which are part of the current solution.
+ * @param r The next row to try at depth.
+ */
+static void pause_task(struct bitboard *bb, int depth, int r) {
+    struct dlx_solver *dlx = bb->dlx;
+    struct dlx_task *task = task_new(depth);
+    task->base = bb->base;
+    for(int i = 0; i <= depth; i++)
+        task->path[i].column = dlx->columns[i],
+        task->path[i].row = i < depth ? dlx->path[i] : r;
+    dlx_push_task(dlx, task);
+}
+
+/**
+ * Searches the current "sub-tree" for solutions.
+ *
+ * @param bb[in] The bitboard which is being searched.
+ * @param covered The columns which have been covered.
+ * @param depth The number of rows which are part of the current solution.
+ *
+ * @return True iff the sub-tree was searched, false if the search was paused.
+ */
+static bool search(struct bitboard *bb, struct bb_mask covered, int depth) {
+    struct dlx_solver *dlx = bb->dlx;
+    const struct dlx_task *task = bb->task;
+
+    /* Follow the path of the task which is being resumed. */
+    bool replay = task && task->path[depth].row >= 0;
+    int column, start = 0;
+    if(replay) {
+        column = task->path[depth].column, start = task->path[depth].row;
+    } else {
+        if((covered.w[0] & bb->full.w[0]) == bb->full.w[0] && (covered.w[1] & bb->full.w[1]) == bb->full.w[1]) {
+            if(dlx->callback(&bb->context))
+                dlx_stop(dlx);
+            return true;
+        }
+        column = choose_column(bb, covered, &bb->live[depth * bb->words]);
+        DLX_STAT(dlx->stats[depth].nodes++);
+    }
+    dlx->columns[depth] = column;
+
+    uint64_t *live = &bb->live[depth * bb->words], *next = live + bb->words;
+    const uint64_t *candidates = &bb->candidates[column * bb->words];
+
+    struct dlx_solution *s = &dlx->solution[depth];
+    s->next = depth ? &dlx->solution[depth - 1] : NULL;
+    for(int i = start >> 6; i < bb->words; i++) {
+        uint64_t bits = live[i] & candidates[i];
+        if(i == start >> 6) bits &= ~0ull << (start & 63);
+        for(; bits; bits &= bits - 1) {
+            int r = (i << 6) + __builtin_ctzll(bits);
+            if(unlikely(should_stop(dlx))) {
+                pause_task(bb, depth, r);
+                return false;
+            }
+
+            DLX_STAT(dlx->stats[depth].rows++);
+            struct matrix_row *row = dlx->rows[r];
+            dlx->before(bb->context.dlx_data, row);
+
+            /* Construct and update the current solution. */
+            s->row = row, bb->context.solution = s;
+            dlx->path[depth] = r;
+            cover_row(bb, next, live, bb->masks[r]);
+
+            bool done = true;
+            bb->task = replay && depth < task->depth && r == start ? task : NULL;
+            if(!call_heuristics(dlx, bb->context.dlx_data, depth)) {
+                struct bb_mask mask = { { covered.w[0] | bb->masks[r].w[0],
+                                          covered.w[1] | bb->masks[r].w[1] } };
+                done = search(bb, mask, depth + 1);
+            }
+
+            dlx->after(bb->context.dlx_data, row);
+            bb->context.solution = s->next;
+            /* The rows above the base of the task have no siblings to search. */
+            if(!done || (replay && depth < task->base))
+                return done;
+        }
+    }
+    return true;
+}
+
+bool bitboard_solve(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task) {
+    /* The search only writes the available rows below depth 0, so the matrix serves every task. */
+    struct bitboard *bb = dlx->bitboard;
+    if(bb && (bb->row_count != dlx->row_count || bb->primary_count != dlx->primary_count))
+        bitboard_free(bb), bb = NULL;
+    if(!bb) bb = dlx->bitboard = bitboard_new(dlx);
+
+    bb->context = (struct dlx_context) { .solution = NULL, .dlx_data = dlx_data };
+    bb->task = task, bb->base = task->base;
+    return search(bb, (struct bb_mask) { { 0, 0 } }, 0);
+}
@@ -0,0 +1,420 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DLX_INTERNAL_H
+#define DLX_INTERNAL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#ifdef DLX_STATS
+    #include <time.h>
+#endif
+
+#include "dlx.h"
+
+#ifdef DLX_STATS
+    /* Executes the statement only if the statistics are compiled in. */
+    #define DLX_STAT(statement) statement
+    /* Calls the heuristic with the given index recording whether it pruned and how long it took. */
+    #define DLX_HEURISTIC(dlx, depth, index, call) \
+        ((dlx)->clock = stats_clock(), stats_heuristic(dlx, depth, index, (call)))
+#else
+    #define DLX_STAT(statement)
+    #define DLX_HEURISTIC(dlx, depth, index, call) ((void) (depth), (call))
+#endif
+
+#ifdef DLX_BUCKETS
+    /* Executes the statement only if the columns are bucketed by their size. */
+    #define DLX_BUCKET(...) __VA_ARGS__
+#else
+    #define DLX_BUCKET(...)
+#endif
+
+struct dlx_heuristic {
+    dlx_heuristic_callback callback;
+    struct dlx_heuristic *next;
+    /* The number of heuristics which were added before this one. */
+    int index;
+};
+
+/* A subtree of the search identified by the rows leading to it. */
+struct dlx_task {
+    /* The rows above base are fixed, the siblings of the rows from base onwards remain to be searched. */
+    int base, depth;
+    /*
+     * The columns and the indices of the rows chosen at each depth. The row at depth is the next
+     * one to try or -1 if the node at depth has not been entered yet.
+     */
+    struct {
+        int column, row;
+    } path[];
+};
+
+/* A double ended queue of tasks, the owner takes from the bottom and thieves from the top. */
+struct dlx_deque {
+    pthread_mutex_t lock;
+    struct dlx_task **tasks;
+    int top, bottom, capacity;
+    atomic_int size;
+};
+
+struct dlx_pool;
+
+/* A thread exploring the tasks of its deque on its own copy of the matrix. */
+struct dlx_worker {
+    struct dlx_solver *dlx;
+    struct dlx_pool *pool;
+    struct dlx_deque deque;
+    void *dlx_data;
+    pthread_t thread;
+    int id;
+};
+
+/* The state shared between all of the workers. */
+struct dlx_pool {
+    struct dlx_worker *workers;
+    int worker_count;
+    /* The number of tasks which are either queued or being explored. */
+    atomic_int pending;
+    /* The number of workers which are waiting for a task. */
+    atomic_int idle;
+};
+
+/* Stores various information related to the current problem. */
+struct dlx_solver {
+    dlx_solution_callback callback;
+    dlx_data_callback before, after;
+
+    struct dlx_heuristic *heuristic;
+    int heuristic_count;
+    /* Searches the tasks when using dancing links. */
+    dlx_search_callback search;
+
+    enum dlx_backend backend;
+    /* The first primary_count columns have to be covered, the others at most once. */
+    int column_count, primary_count, row_count, row_capacity;
+    struct matrix_row **rows;
+
+    /*
+     * The matrix is stored in a single arena as separate arrays of links. The first column_count
+     * nodes are the column headers, the size of each column is stored at the start of the arena.
+     */
+    int32_t *arena, *size;
+    int32_t *U, *D, *L, *R;
+    /* The column and the index of the row of each node. */
+    int32_t *C, *row;
+    int node_count, node_capacity;
+    /* The first column which is still linked or -1 if all of them are covered. */
+    int column;
+    /* The matrix of the bitboard or the sparse set backend, built by the first task it searches. */
+    struct bitboard *bitboard;
+    struct sparse *sparse;
+#ifdef DLX_BUCKETS
+    /*
+     * The linked columns bucketed by their size, bucket s is the bitset of bucket_words words at
+     * buckets + s * bucket_words. No linked column has fewer than min_size nodes, the buckets are
+     * built by dlx_solve once all of the rows have been added.
+     */
+    uint64_t *buckets;
+    int bucket_words, bucket_count, min_size;
+#endif
+
+    /* The columns and rows chosen at each depth of the current branch. */
+    int *columns, *path;
+    struct dlx_solution *solution;
+    /* The worker owning this copy of the matrix or NULL if the search is sequential. */
+    struct dlx_worker *worker;
+
+    /* Points to the flag which pauses the search, copies of the solver share their original's flag. */
+    atomic_bool *stop, stop_flag;
+    /* The tasks from which the paused search is to be resumed. */
+    struct dlx_task **tasks;
+    int task_count, task_capacity;
+    /* The slice of the tree which is searched, see dlx_set_shard, shard_count is 0 for all of it. */
+    int shard_index, shard_count, shard_depth;
+
+#ifdef DLX_STATS
+    /* The counters of each depth. */
+    struct dlx_stats *stats;
+    /* The number of nodes which have been unlinked by cover_column. */
+    uint64_t links;
+    /* The time at which the heuristic which is being timed was called. */
+    uint64_t clock;
+#endif
+};
+
+#ifdef DLX_STATS
+/**
+ * @return A monotonic timestamp in nanoseconds.
+ */
+static inline uint64_t stats_clock(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000llu + time.tv_nsec;
+}
+
+/**
+ * Records the outcome of the heuristic with the given index which was called at dlx->clock.
+ *
+ * @param dlx[in] The solver which is being searched.
+ * @param depth The depth of the row which was chosen last.
+ * @param index The index of the heuristic.
+ * @param prune The value returned by the heuristic.
+ *
+ * @return The value returned by the heuristic.
+ */
+static inline bool stats_heuristic(struct dlx_solver *dlx, int depth, int index, bool prune) {
+    if(index < DLX_STATS_HEURISTICS) {
+        struct dlx_heuristic_stats *stats = &dlx->stats[depth].heuristics[index];
+        stats->calls++, stats->prunes += prune;
+        stats->nanos += stats_clock() - dlx->clock;
+    }
+    return prune;
+}
+#endif
+
+/**
+ * Check if one of the heuristics thinks this branch should be terminated.
+ *
+ * @param dlx[in] The dlx solver instance which is to be used.
+ * @param dlx_data[in] The data which is used by the heuristic.
+ * @param depth The depth of the row which was chosen last.
+ *
+ * @return True iff a heuristic has decided to terminate this branch.
+ */
+static inline bool call_heuristics(struct dlx_solver *dlx, void *dlx_data, int depth) {
+    for(struct dlx_heuristic *h = dlx->heuristic; h; h = h->next)
+        if(DLX_HEURISTIC(dlx, depth, h->index, h->callback(dlx_data)))
+            return true;
+    return false;
+}
+
+/**
+ * @param dlx[in] The solver which is being searched.
+ * @return True iff the search has been asked to pause.
+ */
+static inline bool should_stop(struct dlx_solver *dlx) {
+    return atomic_load_explicit(dlx->stop, memory_order_relaxed);
+}
+
+/**
+ * Unlinks the given node horizontally.
+ * @param dlx[in] The solver whose matrix contains the node.
+ * @param node The node which is to be unlinked horizontally.
+ */
+static inline void hide_h(struct dlx_solver *dlx, int node) {
+    dlx->R[dlx->L[node]] = dlx->R[node], dlx->L[dlx->R[node]] = dlx->L[node];
+}
+
+/**
+ * Restores the current node's horizontal links.
+ * @param dlx[in] The solver whose matrix contains the node.
+ * @param node The node whose links are to be restored horizontally.
+ */
+static inline void show_h(struct dlx_solver *dlx, int node) {
+    dlx->L[dlx->R[node]] = dlx->R[dlx->L[node]] = node;
+}
+
+#ifdef DLX_BUCKETS
+/**
+ * @param buckets[in,out] The buckets of the columns.
+ * @param words The number of words of each bucket.
+ * @param column The column which is to be added to or removed from the bucket.
+ * @param size The size of the bucket.
+ */
+static inline void bucket_toggle(uint64_t *buckets, int words, int column, int size) {
+    buckets[size * words + (column >> 6)] ^= 1llu << (column & 63);
+}
+
+/**
+ * Picks the column with the least number of vertical nodes from the lowest non-empty bucket. Ties
+ * are broken by the order of the columns starting from start, just like the scan of the header list.
+ *
+ * @param dlx[in] The solver whose columns are to be searched.
+ * @param start The starting column.
+ *
+ * @return The column with the least number of vertical nodes.
+ */
+static inline int choose_min(struct dlx_solver *dlx, int start) {
+    const int words = dlx->bucket_words;
+    const uint64_t *bucket = dlx->buckets + dlx->min_size * words;
+    for(;;) {
+        uint64_t any = 0;
+        for(int w = 0; w < words; w++)
+            any |= bucket[w];
+        if(any) break;
+        dlx->min_size++, bucket += words;
+    }
+
+    /* The first column at or after start, wrapping around to the first column. */
+    int w = start >> 6;
+    uint64_t bits = bucket[w] & (~0llu << (start & 63));
+    while(!bits && ++w < words)
+        bits = bucket[w];
+    if(!bits)
+        for(w = 0; !(bits = bucket[w]); w++);
+    return w * 64 + __builtin_ctzll(bits);
+}
+#else
+/**
+ * @param dlx[in] The solver whose columns are to be searched.
+ * @param start The starting column.
+ *
+ * @return The column with the least number of vertical nodes.
+ */
+static inline int choose_min(struct dlx_solver *dlx, int start) {
+    const int32_t *R = dlx->R, *size = dlx->size;
+    int min = start;
+    for(int i = R[min]; i != start; i = R[i])
+        if(size[i] < size[min])
+            min = i;
+    return min;
+}
+#endif
+
+/**
+ * Covers the column unlinking the row objects from the matrix.
+ * @param dlx[in] For updating the column pointer if needed.
+ * @param column The column which is to be covered.
+ */
+static inline void cover_column(struct dlx_solver *dlx, int column) {
+    int32_t *restrict U = dlx->U, *restrict D = dlx->D, *restrict size = dlx->size;
+    const int32_t *R = dlx->R, *C = dlx->C;
+    DLX_BUCKET(uint64_t *restrict buckets = dlx->buckets);
+    DLX_BUCKET(const int words = dlx->bucket_words);
+    DLX_BUCKET(int min = dlx->min_size);
+    /* Only the primary columns are in the buckets. */
+    DLX_BUCKET(const int primary = dlx->primary_count);
+
+    if(column == dlx->column)
+        dlx->column = R[column] == column ? -1 : R[column];
+    hide_h(dlx, column);
+    DLX_BUCKET(if(column < primary) bucket_toggle(buckets, words, column, size[column]));
+    for(int i = D[column]; i != column; i = D[i])
+        for(int j = R[i]; j != i; j = R[j]) {
+            D[U[j]] = D[j], U[D[j]] = U[j];
+            int c = C[j], s = --size[c];
+            (void) s;
+            /* Move the column to the next lower bucket. */
+            DLX_BUCKET(if(c < primary) {
+                bucket_toggle(buckets, words, c, s + 1);
+                bucket_toggle(buckets, words, c, s);
+                if(s < min) min = s;
+            });
+            DLX_STAT(dlx->links++);
+        }
+    DLX_BUCKET(dlx->min_size = min);
+}
+
+/**
+ * Uncovers the column object relinking the row objects.
+ * @param dlx[in] For restoring the column pointer if needed.
+ * @param column The column which is to be uncovered.
+ */
+static inline void uncover_column(struct dlx_solver *dlx, int column) {
+    int32_t *restrict U = dlx->U, *restrict D = dlx->D, *restrict size = dlx->size;
+    const int32_t *L = dlx->L, *C = dlx->C;
+    DLX_BUCKET(uint64_t *restrict buckets = dlx->buckets);
+    DLX_BUCKET(const int words = dlx->bucket_words);
+    DLX_BUCKET(const int primary = dlx->primary_count);
+
+    for(int i = U[column]; i != column; i = U[i])
+        for(int j = L[i]; j != i; j = L[j]) {
+            U[D[j]] = D[U[j]] = j;
+            int c = C[j], s = size[c]++;
+            (void) s;
+            /* Move the column to the next higher bucket. */
+            DLX_BUCKET(if(c < primary) {
+                bucket_toggle(buckets, words, c, s);
+                bucket_toggle(buckets, words, c, s + 1);
+            });
+        }
+    show_h(dlx, column);
+    /* The secondary columns are linked to themselves rather than the list of columns. */
+    if(column >= dlx->primary_count)
+        return;
+    DLX_BUCKET(bucket_toggle(buckets, words, column, size[column]));
+    DLX_BUCKET(if(size[column] < dlx->min_size) dlx->min_size = size[column]);
+    dlx->column = column;
+}
+
+/**
+ * @param worker[in] The worker which is currently searching.
+ * @return True iff the worker should hand off the rest of its current branches.
+ */
+static inline bool should_split(struct dlx_worker *worker) {
+    return atomic_load_explicit(&worker->pool->idle, memory_order_relaxed) > 0 &&
+           !atomic_load_explicit(&worker->deque.size, memory_order_relaxed);
+}
+
+
+/**
+ * @param depth The depth of the task.
+ * @return A new task with room for depth + 1 path entries.
+ */
+struct dlx_task *task_new(int depth);
+
+/**
+ * Adds the given task to the tasks from which the solver resumes its search.
+ * @param dlx[in] The solver which is to be resumed.
+ * @param task[in] The task which is to be added.
+ */
+void dlx_push_task(struct dlx_solver *dlx, struct dlx_task *task);
+
+/**
+ * Turns the given row and all of the rows below it into tasks on the worker's deque.
+ *
+ * @param dlx[in] The matrix of the worker which is splitting its search.
+ * @param depth The depth at which the rows are located.
+ * @param row The first of the rows which are to be handed off.
+ */
+void dlx_split(struct dlx_solver *dlx, int depth, int row);
+
+/**
+ * Searches the given task using the bitboard backend.
+ *
+ * @param dlx[in] The instance of the solver which is to be used.
+ * @param dlx_data[in] Some additional data which may be utilized by the heuristics.
+ * @param task[in] The task which is to be searched.
+ *
+ * @return True iff the task was completed, otherwise the remainder has been added to the tasks.
+ */
+bool bitboard_solve(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task);
+
+/**
+ * @param bb[in] The matrix of the bitboard backend which is to be freed.
+ */
+void bitboard_free(struct bitboard *bb);
+
+/**
+ * Searches the given task using the sparse set backend.
+ *
+ * @param dlx[in] The instance of the solver which is to be used.
+ * @param dlx_data[in] Some additional data which may be utilized by the heuristics.
+ * @param task[in] The task which is to be searched.
+ *
+ * @return True iff the task was completed, otherwise the remainder has been added to the tasks.
+ */
+bool sparse_solve(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task);
+
+/**
+ * @param sp[in] The matrix of the sparse set backend which is to be freed.
+ */
+void sparse_free(struct sparse *sp);
+
+#endif /* DLX_INTERNAL_H */
@@ -0,0 +1,226 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Instantiates the dancing links search with callbacks which are known at compile time, so that
+ * they can be inlined into the search loop. Define the following macros before including this
+ * file, which may be included once per translation unit:
+ *
+ *   DLX_SEARCH                    The name of the instantiated search, see dlx_set_search.
+ *   DLX_BEFORE(dlx_data, row)     Called after a row was added to the current solution.
+ *   DLX_AFTER(dlx_data, row)      Called after a row was removed from the current solution.
+ *   DLX_HEURISTICS(dlx_data, depth)
+ *                                 True iff the branch of the row chosen at depth is to be
+ *                                 terminated, wrap each heuristic in DLX_HEURISTIC to record it.
+ *   DLX_CALLBACK(context)         Called for each solution, the search is paused like by dlx_stop
+ *                                 once it is true.
+ *
+ * Optionally define the following macro:
+ *
+ *   DLX_EXPLORED(dlx_data, depth) Called before the row chosen at depth - 1 is removed from the
+ *                                 solution once every branch below it has been searched by this
+ *                                 solver, rather than being paused or handed off.
+ *
+ * The macros may refer to the solver as dlx. Besides the search this defines the static functions
+ * choose_row, retract_row, enter and search.
+ */
+
+#if !defined(DLX_SEARCH) || !defined(DLX_BEFORE) || !defined(DLX_AFTER) || \
+    !defined(DLX_HEURISTICS) || !defined(DLX_CALLBACK)
+    #error "The search requires DLX_SEARCH, DLX_BEFORE, DLX_AFTER, DLX_HEURISTICS and DLX_CALLBACK."
+#endif
+
+#ifndef DLX_EXPLORED
+    #define DLX_EXPLORED(dlx_data, depth)
+#endif
+
+#include "dlx.h"
+#include "dlx_internal.h"
+
+#include "globals.h"
+
+/**
+ * Adds the given row to the current solution and covers its columns.
+ *
+ * @param dlx[in] The instance of the dlx algorithm.
+ * @param context[in] The current context storing some important exposed information.
+ * @param depth The depth at which the row is chosen.
+ * @param r The node of the row in the column which was chosen at the given depth.
+ */
+static inline void choose_row(struct dlx_solver *dlx, struct dlx_context *context, int depth, int r) {
+    struct matrix_row *row = dlx->rows[dlx->row[r]];
+    DLX_BEFORE(context->dlx_data, row);
+
+    /* Construct and update the current solution. */
+    struct dlx_solution *s = &dlx->solution[depth];
+    s->row = row, s->next = depth ? &dlx->solution[depth - 1] : NULL;
+    context->solution = s;
+    dlx->path[depth] = r;
+    DLX_STAT(dlx->stats[depth].links -= dlx->links);
+    for(int j = dlx->R[r]; j != r; j = dlx->R[j])
+        cover_column(dlx, dlx->C[j]);
+    DLX_STAT(dlx->stats[depth].links += dlx->links);
+}
+
+/**
+ * Removes the row chosen at the given depth from the current solution, undoing choose_row.
+ *
+ * @param dlx[in] The instance of the dlx algorithm.
+ * @param context[in] The current context storing some important exposed information.
+ * @param depth The depth at which the row was chosen.
+ */
+static inline void retract_row(struct dlx_solver *dlx, struct dlx_context *context, int depth) {
+    int r = dlx->path[depth];
+    for(int j = dlx->L[r]; j != r; j = dlx->L[j])
+        uncover_column(dlx, dlx->C[j]);
+    DLX_AFTER(context->dlx_data, dlx->rows[dlx->row[r]]);
+    context->solution = depth ? &dlx->solution[depth - 1] : NULL;
+}
+
+/**
+ * Enters the node at the given depth reporting the current solution if the matrix is empty.
+ *
+ * @param dlx[in] The instance of the dlx algorithm.
+ * @param context[in] The current context storing some important exposed information.
+ * @param depth The depth of the node.
+ *
+ * @return The first row of the column which was chosen and covered or -1 if there is non.
+ */
+static inline int enter(struct dlx_solver *dlx, struct dlx_context *context, int depth) {
+    if(dlx->column < 0) {
+        if(DLX_CALLBACK(context))
+            dlx_stop(dlx);
+        return dlx->columns[depth] = -1;
+    }
+
+    int column = dlx->columns[depth] = choose_min(dlx, dlx->column);
+    DLX_STAT(dlx->stats[depth].nodes++);
+    DLX_STAT(dlx->stats[depth].links -= dlx->links);
+    cover_column(dlx, column);
+    DLX_STAT(dlx->stats[depth].links += dlx->links);
+    return dlx->D[column];
+}
+
+/**
+ * Searches the current "sub-tree" for solutions. The search continues with the given row at the
+ * given depth and does not backtrack past the given base.
+ *
+ * @param dlx[in] The instance of the dlx algorithm.
+ * @param context[in] The current context storing some important exposed information.
+ * @param base The depth of the root of the sub-tree.
+ * @param depth The number of rows which are part of the current solution.
+ * @param r The next row to try in the column chosen at depth.
+ *
+ * @return True iff the sub-tree was searched, otherwise its remainder has been added to the tasks.
+ */
+static bool search(struct dlx_solver *dlx, struct dlx_context *context, int base, int depth, int r) {
+    /* The nodes up to this depth have handed off some of their branches. */
+    int split = base;
+    for(;;) {
+        if(r == dlx->columns[depth]) {
+            /* All of the rows have been tried, backtrack. */
+            if(r >= 0) uncover_column(dlx, r);
+            if(depth == base) return true;
+            if(depth > split) DLX_EXPLORED(context->dlx_data, depth);
+            else split = depth - 1;
+            retract_row(dlx, context, --depth);
+            r = dlx->D[dlx->path[depth]];
+            continue;
+        }
+
+        if(unlikely(should_stop(dlx))) {
+            struct dlx_task *task = task_new(depth);
+            task->base = base;
+            for(int i = 0; i < depth; i++)
+                task->path[i].column = dlx->columns[i],
+                task->path[i].row = dlx->row[dlx->path[i]];
+            task->path[depth].column = dlx->columns[depth];
+            task->path[depth].row = dlx->row[r];
+            dlx_push_task(dlx, task);
+
+            /* Restore the matrix down to the base. */
+            uncover_column(dlx, dlx->columns[depth]);
+            while(depth > base) {
+                retract_row(dlx, context, --depth);
+                uncover_column(dlx, dlx->columns[depth]);
+            }
+            return false;
+        }
+
+        /* Hand off the remaining rows if another worker has run out of work. */
+        if(unlikely(dlx->worker != NULL) && dlx->D[r] != dlx->columns[depth] && should_split(dlx->worker)) {
+            dlx_split(dlx, depth, r);
+            if(split < depth) split = depth;
+            r = dlx->columns[depth];
+            continue;
+        }
+
+        DLX_STAT(dlx->stats[depth].rows++);
+        choose_row(dlx, context, depth, r);
+        if(DLX_HEURISTICS(context->dlx_data, depth)) {
+            retract_row(dlx, context, depth);
+            r = dlx->D[r];
+        } else {
+            r = enter(dlx, context, ++depth);
+        }
+    }
+}
+
+/**
+ * Replays the path of the given task and searches the resulting sub-tree.
+ *
+ * @param dlx[in] The instance of the dlx algorithm.
+ * @param dlx_data[in] The data which is passed to the callbacks.
+ * @param task[in] The task which is to be searched.
+ *
+ * @return True iff the task was completed, otherwise its remainder has been added to the tasks.
+ */
+static bool DLX_SEARCH(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task) {
+    struct dlx_context context = { .solution = NULL, .dlx_data = dlx_data };
+    int depth = task->depth, next = -1;
+
+    for(int i = 0; i <= depth && task->path[i].row >= 0; i++) {
+        int column = dlx->columns[i] = task->path[i].column;
+        cover_column(dlx, column);
+
+        int r = dlx->D[column];
+        while(dlx->row[r] != task->path[i].row)
+            r = dlx->D[r];
+        if(i < depth) choose_row(dlx, &context, i, r);
+        else next = r;
+    }
+
+    bool done = true;
+    if(next >= 0)
+        done = search(dlx, &context, task->base, depth, next);
+    /* The heuristics have not been consulted for the last row of the path yet. */
+    else if(!depth || !DLX_HEURISTICS(dlx_data, depth - 1))
+        done = search(dlx, &context, task->base, depth, enter(dlx, &context, depth));
+
+    for(int i = task->base - 1; i >= 0; i--) {
+        retract_row(dlx, &context, i);
+        uncover_column(dlx, dlx->columns[i]);
+    }
+    return done;
+}
+
+#undef DLX_SEARCH
+#undef DLX_BEFORE
+#undef DLX_AFTER
+#undef DLX_HEURISTICS
+#undef DLX_CALLBACK
+#undef DLX_EXPLORED
@@ -0,0 +1,308 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "dlx.h"
+#include "dlx_internal.h"
+
+#include <string.h>
+
+#include "globals.h"
+
+/*
+ * The matrix stored as flat arrays of items and options, following Knuth's sparse sets. Deleting
+ * a node from the set of its item swaps it behind the nodes which are still active, so restoring
+ * it in the reverse order only has to grow the set again. Items are either primary or secondary,
+ * colours aren't supported since the rows carry nothing but their columns.
+ */
+struct sparse {
+    struct dlx_solver *dlx;
+    struct dlx_context context;
+    /* The number of rows and primary items of the solver when the matrix was built. */
+    int row_count, primary_count;
+
+    /* The item, the option and the position in the set of its item of each node. */
+    int *item, *option, *location;
+    /* The nodes of row r are first[r] to first[r + 1] - 1. */
+    int *first;
+    /* The nodes of item i start at set[start[i]], of which the first size[i] are active. */
+    int *set, *start, *size;
+    /* The primary items which haven't been covered and the position of each primary item in active. */
+    int *active, *position, active_count;
+
+    /* The number of words needed to store a set of rows. */
+    int words;
+    /* The rows of the item chosen at each depth. */
+    uint64_t *branches;
+
+    /* The task whose path is being replayed or NULL once the search has left it. */
+    const struct dlx_task *task;
+    int base;
+};
+
+/**
+ * @param dlx[in] The solver whose rows are to be converted.
+ * @return The matrix of the solver as sparse sets with every item being uncovered.
+ */
+static struct sparse *sparse_new(struct dlx_solver *dlx) {
+    struct sparse *sp = calloc_s(1, sizeof(*sp));
+    int items = dlx->column_count, words = dlx_words(items), node_count = 0;
+    sp->dlx = dlx;
+    sp->row_count = dlx->row_count, sp->primary_count = dlx->primary_count;
+    sp->first = malloc_s((dlx->row_count + 1) * sizeof(*sp->first));
+    sp->start = malloc_s((items + 1) * sizeof(*sp->start));
+    sp->size = calloc_s(items + 1, sizeof(*sp->size));
+    for(int r = 0; r < dlx->row_count; r++) {
+        sp->first[r] = node_count;
+        for(int w = 0; w < words; w++)
+            for(uint64_t bits = dlx->rows[r]->row[w]; bits; bits &= bits - 1)
+                sp->size[w * 64 + __builtin_ctzll(bits)]++, node_count++;
+    }
+    sp->first[dlx->row_count] = node_count;
+
+    sp->item = malloc_s((node_count + 1) * sizeof(*sp->item));
+    sp->option = malloc_s((node_count + 1) * sizeof(*sp->option));
+    sp->location = malloc_s((node_count + 1) * sizeof(*sp->location));
+    sp->set = malloc_s((node_count + 1) * sizeof(*sp->set));
+    for(int i = 0, s = 0; i < items; i++)
+        sp->start[i] = s, s += sp->size[i], sp->size[i] = 0;
+    for(int r = 0, x = 0; r < dlx->row_count; r++) {
+        for(int w = 0; w < words; w++) {
+            for(uint64_t bits = dlx->rows[r]->row[w]; bits; bits &= bits - 1, x++) {
+                int i = w * 64 + __builtin_ctzll(bits);
+                sp->item[x] = i, sp->option[x] = r, sp->location[x] = sp->size[i];
+                sp->set[sp->start[i] + sp->size[i]++] = x;
+            }
+        }
+    }
+
+    sp->active = malloc_s((items + 1) * sizeof(*sp->active));
+    sp->position = malloc_s((items + 1) * sizeof(*sp->position));
+    sp->active_count = dlx->primary_count;
+    for(int i = 0; i < dlx->primary_count; i++)
+        sp->active[i] = sp->position[i] = i;
+
+    sp->words = (dlx->row_count + 63) / 64;
+    sp->branches = malloc_s((size_t) (items + 1) * sp->words * sizeof(*sp->branches));
+    return sp;
+}
+
+void sparse_free(struct sparse *sp) {
+    free(sp->first);
+    free(sp->start);
+    free(sp->size);
+    free(sp->item);
+    free(sp->option);
+    free(sp->location);
+    free(sp->set);
+    free(sp->active);
+    free(sp->position);
+    free(sp->branches);
+    free(sp);
+}
+
+/**
+ * Removes the options containing the given item from the sets of their other items.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param i The item whose options are to be hidden.
+ */
+static inline void hide(struct sparse *sp, int i) {
+    int *restrict set = sp->set, *restrict size = sp->size, *restrict location = sp->location;
+    const int *item = sp->item, *first = sp->first;
+    for(int k = sp->start[i], end = k + size[i]; k < end; k++) {
+        int x = set[k], o = sp->option[x];
+        for(int y = first[o]; y < first[o + 1]; y++) {
+            if(y == x) continue;
+            /* Swap the node with the last active node of its item. */
+            int j = item[y], s = --size[j];
+            int last = set[sp->start[j] + s], l = location[y];
+            set[sp->start[j] + l] = last, location[last] = l;
+            set[sp->start[j] + s] = y, location[y] = s;
+            DLX_STAT(sp->dlx->links++);
+        }
+    }
+}
+
+/**
+ * Restores the options hidden by hide, which must be undone in the reverse order.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param i The item whose options are to be restored.
+ */
+static inline void unhide(struct sparse *sp, int i) {
+    int *restrict size = sp->size;
+    const int *item = sp->item, *first = sp->first;
+    for(int k = sp->start[i] + size[i] - 1; k >= sp->start[i]; k--) {
+        int x = sp->set[k], o = sp->option[x];
+        for(int y = first[o + 1] - 1; y >= first[o]; y--)
+            if(y != x) size[item[y]]++;
+    }
+}
+
+/**
+ * Covers the item, a primary item also stops being active.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param i The item which is to be covered.
+ */
+static inline void cover(struct sparse *sp, int i) {
+    if(i < sp->dlx->primary_count) {
+        int p = sp->position[i], last = sp->active[--sp->active_count];
+        sp->active[p] = last, sp->position[last] = p;
+        sp->active[sp->active_count] = i, sp->position[i] = sp->active_count;
+    }
+    hide(sp, i);
+}
+
+/**
+ * Uncovers the item covered last.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param i The item which is to be uncovered.
+ */
+static inline void uncover(struct sparse *sp, int i) {
+    unhide(sp, i);
+    if(i < sp->dlx->primary_count)
+        sp->active_count++;
+}
+
+/**
+ * @param sp[in] The sparse sets which are being searched.
+ * @return The active item with the fewest options, ties are broken by the lowest index.
+ */
+static int choose_item(struct sparse *sp) {
+    int min = -1;
+    for(int k = 0; k < sp->active_count; k++) {
+        int i = sp->active[k];
+        if(min < 0 || sp->size[i] < sp->size[min] || (sp->size[i] == sp->size[min] && i < min))
+            min = i;
+    }
+    return min;
+}
+
+/**
+ * Adds the remainder of the current task to the solver's tasks.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param depth The number of rows which are part of the current solution.
+ * @param r The next row to try at depth.
+ */
+static void pause_task(struct sparse *sp, int depth, int r) {
+    struct dlx_solver *dlx = sp->dlx;
+    struct dlx_task *task = task_new(depth);
+    task->base = sp->base;
+    for(int i = 0; i <= depth; i++)
+        task->path[i].column = dlx->columns[i],
+        task->path[i].row = i < depth ? dlx->path[i] : r;
+    dlx_push_task(dlx, task);
+}
+
+/**
+ * Searches the current "sub-tree" for solutions.
+ *
+ * @param sp[in] The sparse sets which are being searched.
+ * @param depth The number of rows which are part of the current solution.
+ *
+ * @return True iff the sub-tree was searched, false if the search was paused.
+ */
+static bool search(struct sparse *sp, int depth) {
+    struct dlx_solver *dlx = sp->dlx;
+    const struct dlx_task *task = sp->task;
+
+    /* Follow the path of the task which is being resumed. */
+    bool replay = task && task->path[depth].row >= 0;
+    int column, start = 0;
+    if(replay) {
+        column = task->path[depth].column, start = task->path[depth].row;
+    } else {
+        if(!sp->active_count) {
+            if(dlx->callback(&sp->context))
+                dlx_stop(dlx);
+            return true;
+        }
+        column = choose_item(sp);
+        DLX_STAT(dlx->stats[depth].nodes++);
+    }
+    dlx->columns[depth] = column;
+
+    /* Try the options in the order of their rows, which doesn't depend on the swaps so far. */
+    uint64_t *branches = &sp->branches[depth * sp->words];
+    memset(branches, 0, sp->words * sizeof(*branches));
+    for(int k = sp->start[column], end = k + sp->size[column]; k < end; k++) {
+        int r = sp->option[sp->set[k]];
+        branches[r >> 6] |= 1ull << (r & 63);
+    }
+    cover(sp, column);
+
+    struct dlx_solution *s = &dlx->solution[depth];
+    s->next = depth ? &dlx->solution[depth - 1] : NULL;
+    for(int i = start >> 6; i < sp->words; i++) {
+        uint64_t bits = branches[i];
+        if(i == start >> 6) bits &= ~0ull << (start & 63);
+        for(; bits; bits &= bits - 1) {
+            int r = (i << 6) + __builtin_ctzll(bits);
+            if(unlikely(should_stop(dlx))) {
+                pause_task(sp, depth, r);
+                uncover(sp, column);
+                return false;
+            }
+
+            DLX_STAT(dlx->stats[depth].rows++);
+            struct matrix_row *row = dlx->rows[r];
+            dlx->before(sp->context.dlx_data, row);
+
+            /* Construct and update the current solution. */
+            s->row = row, sp->context.solution = s;
+            dlx->path[depth] = r;
+            for(int y = sp->first[r]; y < sp->first[r + 1]; y++)
+                if(sp->item[y] != column) cover(sp, sp->item[y]);
+
+            bool done = true;
+            sp->task = replay && depth < task->depth && r == start ? task : NULL;
+            if(!call_heuristics(dlx, sp->context.dlx_data, depth))
+                done = search(sp, depth + 1);
+
+            for(int y = sp->first[r + 1] - 1; y >= sp->first[r]; y--)
+                if(sp->item[y] != column) uncover(sp, sp->item[y]);
+            dlx->after(sp->context.dlx_data, row);
+            sp->context.solution = s->next;
+            /* The rows above the base of the task have no siblings to search. */
+            if(!done || (replay && depth < task->base)) {
+                uncover(sp, column);
+                return done;
+            }
+        }
+    }
+    uncover(sp, column);
+    return true;
+}
+
+bool sparse_solve(struct dlx_solver *dlx, void *dlx_data, struct dlx_task *task) {
+    /*
+     * Every search restores the sizes of the sets it shrank, so the matrix serves every task. Only
+     * the order within the sets changes, which neither the choice of the item nor that of the
+     * options depends on.
+     */
+    struct sparse *sp = dlx->sparse;
+    if(sp && (sp->row_count != dlx->row_count || sp->primary_count != dlx->primary_count))
+        sparse_free(sp), sp = NULL;
+    if(!sp) sp = dlx->sparse = sparse_new(dlx);
+
+    sp->context = (struct dlx_context) { .solution = NULL, .dlx_data = dlx_data };
+    sp->task = task, sp->base = task->base;
+    return search(sp, 0);
+}
@@ -0,0 +1,455 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cube.h"
+#include "globals.h"
+
+/* The tile permutations of the symmetries which preserve the cover matrix. */
+static int symmetries[48][60];
+static int symmetry_count;
+
+/**
+ * @param s The starting node of the walk.
+ * @param rot The starting rotation of the walk.
+ * @param seq The sequence of steps to perform.
+ *
+ * @return The nodes which were visited during the graph walk.
+ */
+static struct matrix_row *generate_walk(int s, int rot, const enum direction seq[][4]) {
+    struct matrix_row *row = calloc_s(1, sizeof(*row));
+    row->row = calloc_s(dlx_words(72), sizeof(uint64_t));
+
+    struct row_data *data = calloc_s(1, sizeof(*data));
+    row->row_data = data;
+
+    data->flags |= 1llu << (unsigned) s;
+    dlx_set(row, s);
+    for(int i = 0; i < 4; i++) {
+        int curr_pos = s;
+        int curr_rot = rot;
+        for(int j = 0; j < 4; j++) {
+            enum direction next = seq[i][j];
+            if(next == NOP) break;
+            next = rotate(next, curr_rot);
+            curr_rot += ROTATION_MATRIX[curr_pos][next - 1];
+            curr_pos = NEIGHBOUR_MATRIX[curr_pos][next - 1];
+            /* Ensure that 5 unique nodes were visited. */
+            if(dlx_has(row, curr_pos)) {
+                free(row->row_data);
+                free(row->row);
+                free(row);
+                return NULL;
+            }
+            data->flags |= 1llu << (unsigned) curr_pos;
+            dlx_set(row, curr_pos);
+        }
+    }
+    return row;
+}
+
+/**
+ * @param a[in] The 1st row which is to be compared to the 2nd.
+ * @param b[in] The 2nd row which is to be compared to the 1st.
+ *
+ * @return True iff the two rows are the same false otherwise.
+ */
+static bool row_equals(struct matrix_row *a, struct matrix_row *b) {
+    return !memcmp(a->row, b->row, dlx_words(72) * sizeof(uint64_t));
+}
+
+/**
+ * @param r[in] The row which is to be hashed.
+ * @return The hash of the row's columns.
+ */
+static uint64_t row_hash(struct matrix_row *r) {
+    uint64_t hash = 0;
+    for(int i = 0; i < dlx_words(72); i++)
+        hash = (hash ^ r->row[i]) * 0x9e3779b97f4a7c15llu;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * Removes duplicates from the linked list by looking up each row in a hash table of the rows
+ * which were kept before it.
+ *
+ * @param[in,out] matrix The matrix which is to be optimized.
+ */
+static void dedupe_walks(struct matrix_row *matrix) {
+    int size = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        size++;
+
+    /* An open addressing table which is at most half full. */
+    size_t capacity = 1;
+    while(capacity < 2 * (size_t) size)
+        capacity <<= 1;
+    struct matrix_row **table = calloc_s(capacity, sizeof(*table));
+
+    for(struct matrix_row *i = matrix, *p = NULL; i; ) {
+        size_t slot = row_hash(i) & (capacity - 1);
+        while(table[slot] && !row_equals(table[slot], i))
+            slot = (slot + 1) & (capacity - 1);
+
+        if(!table[slot]) {
+            table[slot] = i, p = i, i = i->next;
+            continue;
+        }
+
+        /* The first row is never a duplicate, so p is set. */
+        struct matrix_row *tmp = i;
+        p->next = i = i->next;
+        free(tmp->row_data);
+        free(tmp->row);
+        free(tmp);
+    }
+    free(table);
+}
+
+/**
+ * Assigns each walk a weight.
+ * @param matrix[in,out] The matrix which is to be weighted.
+ */
+static void weight_walks(struct matrix_row *matrix) {
+    for(struct matrix_row *i = matrix; i; i = i->next) {
+        struct row_data *data = i->row_data;
+        /* Construct the function. */
+        int weights[6] = { };
+        for(int j = 0; j < 60; j++)
+            if(dlx_has(i, j))
+                for(int k = 0; k < 6; k++)
+                    weights[k] += AREA_MATRIX[j][k];
+        /* Maximize the function. */
+        int max = weights[0];
+        for(int j = 1; j < 6; j++)
+            if(max < weights[j])
+                max = weights[j];
+        data->weight = max;
+    }
+}
+
+/**
+ * @param a[in] The 1st parameter that should be compared to the 2nd.
+ * @param b[in] The 2nd parameter that should be compared to the 1st.
+ * @return A value less than 0 iff a < b, 0 iff a = b and a value greater than 0 iff a > b.
+ */
+static int cmp_matrix_row(const void *a, const void *b) {
+    struct row_data *ad = (*(struct matrix_row **) a)->row_data;
+    struct row_data *bd = (*(struct matrix_row **) b)->row_data;
+
+    return ad->weight > bd->weight ? -1 :
+           ad->weight < bd->weight ?  1 : 0;
+}
+
+/**
+ * @param matrix[in] The rows which are to be sorted.
+ * @return The sorted linked list.
+ */
+static struct matrix_row *sort_walks(struct matrix_row *matrix) {
+    int size = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        size++;
+
+    struct matrix_row *rows[size + 1], **tmp = rows;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        *tmp = i, tmp++;
+    rows[size] = NULL;
+
+    qsort(rows, size, sizeof(struct matrix_row *), cmp_matrix_row);
+
+    for(int i = 0; i < size; i++)
+        ((struct row_data *) rows[i]->row_data)->id = i;
+
+    rows[0]->next = rows[1];
+    for(int i = 1; i < size; i++)
+        rows[i]->prev = rows[i - 1],
+        rows[i]->next = rows[i + 1];
+    return rows[0];
+}
+
+/**
+ * Maps each tile onto its image under the symmetry which takes tile 0 to the given tile. The graph
+ * is walked breadth first from tile 0 and every step is replayed from the image.
+ *
+ * @param s The image of tile 0.
+ * @param rot The rotation of the replayed walk.
+ * @param mirror True iff the replayed walk is flipped.
+ * @param tiles[out] The image of each tile.
+ *
+ * @return True iff the walks define a permutation of the tiles.
+ */
+static bool map_tiles(int s, int rot, bool mirror, int tiles[60]) {
+    int queue[60], head = 0, tail = 0;
+    /* The rotation of the walk at each tile and at its image. */
+    int rots[60][2];
+    for(int i = 0; i < 60; i++)
+        tiles[i] = -1;
+
+    tiles[0] = s, rots[0][0] = 0, rots[0][1] = rot;
+    queue[tail++] = 0;
+    while(head < tail) {
+        int curr = queue[head++];
+        for(enum direction dir = UP; dir <= LEFT; dir++) {
+            enum direction a = rotate(dir, rots[curr][0]);
+            enum direction b = rotate(mirror ? flip(dir) : dir, rots[curr][1]);
+            int next = NEIGHBOUR_MATRIX[curr][a - 1];
+            int image = NEIGHBOUR_MATRIX[tiles[curr]][b - 1];
+            if(tiles[next] == -1) {
+                tiles[next] = image;
+                rots[next][0] = (rots[curr][0] + ROTATION_MATRIX[curr][a - 1]) % 4;
+                rots[next][1] = (rots[curr][1] + ROTATION_MATRIX[tiles[curr]][b - 1]) % 4;
+                queue[tail++] = next;
+            } else if(tiles[next] != image)
+                return false;
+        }
+    }
+
+    /* Ensure that no two tiles were mapped onto the same image. */
+    uint64_t images = 0;
+    for(int i = 0; i < 60; i++)
+        images |= 1llu << (unsigned) tiles[i];
+    return tail == 60 && images == (1llu << 60) - 1;
+}
+
+/**
+ * @param a[in] The 1st placement which is to be compared to the 2nd.
+ * @param b[in] The 2nd placement which is to be compared to the 1st.
+ * @return A value less than 0 iff a < b, 0 iff a = b and a value greater than 0 iff a > b.
+ */
+static int cmp_placement(const void *a, const void *b) {
+    const struct placement *ap = a, *bp = b;
+    if(ap->piece != bp->piece)
+        return ap->piece - bp->piece;
+    return ap->flags < bp->flags ? -1 :
+           ap->flags > bp->flags ?  1 : 0;
+}
+
+/**
+ * @param r[in] A row of the cover matrix.
+ * @return The piece which is placed by the row.
+ */
+static int row_piece(struct matrix_row *r) {
+    for(int i = 0; i < 12; i++)
+        if(dlx_has(r, i + 60))
+            return i;
+    return -1;
+}
+
+/**
+ * @param tiles[in] The image of each tile.
+ * @param flags The tiles which are to be mapped.
+ * @return The images of the tiles.
+ */
+static uint64_t map_flags(const int tiles[60], uint64_t flags) {
+    uint64_t result = 0;
+    for(; flags; flags &= flags - 1)
+        result |= 1llu << (unsigned) tiles[__builtin_ctzll(flags)];
+    return result;
+}
+
+/**
+ * Derives the symmetries of the cube from the graph and keeps those which map every row onto a
+ * row placing the same piece with the same weight.
+ *
+ * @param placements[in] The sorted placements of the cover matrix.
+ * @param size The number of placements.
+ */
+static void generate_symmetries(struct placement *placements, int size) {
+    symmetry_count = 0;
+    int tiles[60];
+    for(int s = 0; s < 60; s++) {
+        for(int rot = 0; rot < 4; rot++) {
+            for(int mirror = 0; mirror < 2; mirror++) {
+                if(!map_tiles(s, rot, mirror, tiles))
+                    continue;
+
+                bool valid = true;
+                for(int i = 0; i < size && valid; i++) {
+                    struct placement key = placements[i];
+                    key.flags = map_flags(tiles, key.flags);
+                    struct placement *image =
+                        bsearch(&key, placements, size, sizeof(key), cmp_placement);
+                    valid = image && image->weight == key.weight;
+                }
+
+                for(int i = 0; i < symmetry_count && valid; i++)
+                    valid = memcmp(symmetries[i], tiles, sizeof(tiles)) != 0;
+                if(valid && symmetry_count < 48)
+                    memcpy(symmetries[symmetry_count++], tiles, sizeof(tiles));
+            }
+        }
+    }
+}
+
+/**
+ * Breaks the symmetry of the cube by fixing the piece whose placements fall into the fewest orbits
+ * under the symmetry group to one placement of each orbit. Every packing can be mapped onto one of
+ * the remaining packings with the same score.
+ *
+ * @param matrix[in,out] The matrix which is to be reduced.
+ * @return The reduced matrix.
+ */
+static struct matrix_row *break_symmetry(struct matrix_row *matrix) {
+    int size = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        size++;
+
+    struct placement *placements = malloc_s(size * sizeof(*placements));
+    struct placement *tmp = placements;
+    for(struct matrix_row *i = matrix; i; i = i->next, tmp++) {
+        struct row_data *data = i->row_data;
+        tmp->flags = data->flags, tmp->piece = row_piece(i), tmp->weight = data->weight;
+    }
+    qsort(placements, size, sizeof(*placements), cmp_placement);
+    generate_symmetries(placements, size);
+
+    /* Mark every placement which is the image of a placement before it. */
+    bool *redundant = calloc_s(size, sizeof(*redundant));
+    int orbits[12] = { };
+    for(int i = 0; i < size; i++) {
+        if(redundant[i]) continue;
+        orbits[placements[i].piece]++;
+        for(int j = 1; j < symmetry_count; j++) {
+            struct placement key = placements[i];
+            key.flags = map_flags(symmetries[j], key.flags);
+            struct placement *image =
+                bsearch(&key, placements, size, sizeof(key), cmp_placement);
+            if(image != &placements[i])
+                redundant[image - placements] = true;
+        }
+    }
+
+    int piece = 0;
+    for(int i = 1; i < 12; i++)
+        if(orbits[i] < orbits[piece])
+            piece = i;
+
+    /* Remove the redundant placements of the piece. */
+    for(struct matrix_row **i = &matrix; *i; ) {
+        struct matrix_row *r = *i;
+        struct placement key = {
+            ((struct row_data *) r->row_data)->flags, row_piece(r), 0
+        };
+        struct placement *p = bsearch(&key, placements, size, sizeof(key), cmp_placement);
+        if(key.piece == piece && redundant[p - placements]) {
+            *i = r->next;
+            free(r->row_data);
+            free(r->row);
+            free(r);
+        } else i = &r->next;
+    }
+
+    free(placements);
+    free(redundant);
+    return matrix;
+}
+
+/**
+ * Generates the rows needed for the exact cover formulation.
+ * @return The matrix rows of the exact cover formulation.
+ */
+static struct matrix_row *generate_walks() {
+    struct matrix_row *result = NULL;
+    enum direction flipped[4][4];
+    for(int i = 0; i < 12; i++) {
+        /* Flip the walk. */
+        for(int j = 0; j < 4; j++)
+            for(int k = 0; k < 4; k++)
+                flipped[j][k] = flip(GENERATOR_PENTOMINOS[i][j][k]);
+
+        for(int j = 0; j < 60; j++) {
+            for(int k = 1; k < 5; k++) {
+                struct matrix_row *walk = generate_walk(j, k, GENERATOR_PENTOMINOS[i]);
+                if(walk)
+                    walk->next = result, dlx_set(walk, i + 60), result = walk;
+            }
+
+            for(int k = 1; k < 5; k++) {
+                struct matrix_row *walk = generate_walk(j, k, flipped);
+                if(walk)
+                    walk->next = result, dlx_set(walk, i + 60), result = walk;
+            }
+        }
+    }
+    dedupe_walks(result);
+    weight_walks(result);
+    result = break_symmetry(result);
+    result = sort_walks(result);
+    return result;
+}
+
+/**
+ * Writes the rows and the symmetries as a table which the solver loads without generating them.
+ *
+ * @param file[in] The file to which the table is to be written.
+ * @param matrix[in] The weight sorted rows.
+ */
+static void write_table(FILE *file, struct matrix_row *matrix) {
+    int size = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        size++;
+
+    fprintf(file, "/* Generated by generate.c, do not edit. */\n\n");
+    fprintf(file, "#define PLACEMENT_COUNT %d\n\n", size);
+    fprintf(file, "static const struct placement PLACEMENTS[PLACEMENT_COUNT] = {\n");
+    for(struct matrix_row *i = matrix; i; i = i->next) {
+        struct row_data *data = i->row_data;
+        fprintf(file, "    { 0x%015llxllu, %2d, %2d },\n",
+                (unsigned long long) data->flags, row_piece(i), data->weight);
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "const int SYMMETRY_COUNT = %d;\n\n", symmetry_count);
+    fprintf(file, "const int SYMMETRY_MATRIX[48][60] = {\n");
+    for(int i = 0; i < symmetry_count; i++) {
+        fprintf(file, "    {");
+        for(int j = 0; j < 60; j++)
+            fprintf(file, "%s%d", j ? ", " : " ", symmetries[i][j]);
+        fprintf(file, " },\n");
+    }
+    fprintf(file, "};\n");
+}
+
+int main(int argc, char *argv[]) {
+    if(argc != 2) {
+        fprintf(stderr, "Usage: %s output\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if(!file) {
+        fprintf(stderr, "Failed to open: %s\n", argv[1]);
+        return 1;
+    }
+
+    struct matrix_row *matrix = generate_walks();
+    write_table(file, matrix);
+    int result = fclose(file) ? 1 : 0;
+
+    /* Free the matrix. */
+    while(matrix) {
+        struct matrix_row *tmp = matrix;
+        matrix = matrix->next;
+        free(tmp->row_data);
+        free(tmp->row);
+        free(tmp);
+    }
+    return result;
+}
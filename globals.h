@@ -18,6 +18,7 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #ifdef __GNUC__
@@ -50,4 +51,27 @@ static inline void *calloc_s(size_t nmemb, size_t size) {
     return object;
 }
 
+/**
+ * @param object[in] The region of memory which is to be resized or NULL.
+ * @param size The number of bytes the region should have.
+ *
+ * @return The resized region of memory.
+ */
+static inline void *realloc_s(void *object, size_t size) {
+    object = realloc(object, size);
+    if(unlikely(!object)) exit(1);
+    return object;
+}
+
+/**
+ * Raises the value without ever lowering it, even if it is shared with other threads or processes.
+ *
+ * @param value[in,out] The value which is to be raised.
+ * @param to The value to which it is to be raised.
+ */
+static inline void atomic_raise(_Atomic int *value, int to) {
+    int current = atomic_load_explicit(value, memory_order_relaxed);
+    while(current < to && !atomic_compare_exchange_weak(value, &current, to));
+}
+
 #endif /* GLOBALS_H */
@@ -17,134 +17,446 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include <string.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "cube.h"
 #include "dlx.h"
+#include "globals.h"
+#include "mitm.h"
+#include "packer.h"
+#include "packing.h"
+#include "sink.h"
+#include "table.h"
+#include "topk.h"
 
-struct dlx_data {
-    struct matrix_row *matrix;
-
-    double best_score, current_score;
-    uint64_t graph;
-    int k;
-};
-
-static void print_solution(struct dlx_solution *solution) {
-    for(struct dlx_solution *i = solution; i; i = i->next) {
-        for(int j = 0; j < 60; j++)
-            if(i->row->row[j])
-                printf("%d ", j);
-        for(int j = 0; j < 12; j++)
-            if(i->row->row[j + 60])
-                printf("[%d] ", j);
-        printf("\n");
-    }
-    printf("\n");
+/* The number of random paths behind the estimate of the rows which are left in a progress report. */
+#define PROGRESS_PROBES 64
+
+/* The solver which is paused by the signal handler. */
+static struct dlx_solver *solver;
+/* Set iff the search was interrupted rather than paused for a periodic checkpoint. */
+static volatile sig_atomic_t interrupted;
+
+static void signal_handler(int signal) {
+    if(signal != SIGALRM)
+        interrupted = 1;
+    dlx_stop(solver);
 }
 
-static void solution_callback(struct dlx_context *context) {
-    struct dlx_data *data = context->dlx_data;
-    if(data->best_score < data->current_score)
-        data->best_score = data->current_score;
+/**
+ * Atomically replaces the checkpoint with the incumbent and the branches of the paused search.
+ *
+ * @param file[in] The path of the checkpoint.
+ * @param best The best score in sixths which has been found so far.
+ * @param bound The highest bound in sixths of a branch which was pruned because of the epsilon so far.
+ *
+ * @return True iff the checkpoint was written successfully.
+ */
+static bool save_checkpoint(const char *file, int best, int bound) {
+    char tmp[strlen(file) + 5];
+    sprintf(tmp, "%s.tmp", file);
 
-    if(fabs(data->current_score - data->best_score) < 0.001) {
-        printf("Score: %f\n", data->current_score);
-        print_solution(context->solution);
-        fflush(stdout);
-    }
+    FILE *f = fopen(tmp, "wb");
+    if(!f) return false;
+    bool result = fwrite(&best, sizeof(best), 1, f) == 1 && fwrite(&bound, sizeof(bound), 1, f) == 1 &&
+                  dlx_save(solver, f);
+    result = !fclose(f) && result;
+    return result && !rename(tmp, file);
 }
 
-static inline void hide(struct matrix_row *r) {
-    if(r->prev) r->prev->next = r->next;
-    if(r->next) r->next->prev = r->prev;
+/**
+ * @param file[in] The checkpoint which is to be read.
+ * @param best[out] The best score in sixths which had been found.
+ * @param bound[out] The highest bound in sixths of a branch which had been pruned because of the epsilon.
+ *
+ * @return True iff the checkpoint was read successfully.
+ */
+static bool load_checkpoint(FILE *file, int *best, int *bound) {
+    return fread(best, sizeof(*best), 1, file) == 1 && fread(bound, sizeof(*bound), 1, file) == 1 &&
+           dlx_load(solver, file);
 }
 
-static inline void show(struct matrix_row *r) {
-    if(r->prev) r->prev->next = r;
-    if(r->next) r->next->prev = r;
+/**
+ * @param data[in] The data of each thread.
+ * @param thread_count The number of threads.
+ *
+ * @return The highest bound in sixths of a branch which any of the threads pruned because of the epsilon.
+ */
+static int pruned_bound(const struct dlx_data *data, int thread_count) {
+    int bound = 0;
+    for(int i = 0; i < thread_count; i++)
+        if(data[i].pruned_bound > bound) bound = data[i].pruned_bound;
+    return bound;
 }
 
-void before(struct dlx_data *data, struct dlx_node *r) {
-    struct row_data *row_data = r->row->row_data;
-    data->current_score += row_data->weight;
-    data->graph |= row_data->flags;
-    data->k++;
+/**
+ * @param start[in] The time at which the run started.
+ * @return The number of seconds since the start.
+ */
+static double elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
 
-    for(struct dlx_node *i = r->R; i != r; i = i->R)
-        for(struct dlx_node *j = i->C->D; j != i->C; j = j->D)
-            hide(j->row);
+/**
+ * Reports how far the paused search has come and how long the rows which are left will take at
+ * the current rate.
+ *
+ * @param remaining The share of the branches of the tree which is left, see dlx_remaining.
+ * @param left The estimated number of rows which are left, see dlx_estimate.
+ * @param seconds The number of seconds since the start of the run.
+ * @param nodes The number of rows which were added to the packings since the start of the run.
+ */
+static void report_progress(double remaining, double left, double seconds, uint64_t nodes) {
+    double rate = seconds > 0 ? nodes / seconds : 0;
+    fprintf(stderr, "Progress: %.4f%% of the branches, %.0f nodes/s, about %.3e nodes left",
+            100 * (1 - remaining), rate, left);
+    if(rate > 0 && left / rate < 1e12) {
+        unsigned long long s = left / rate;
+        fprintf(stderr, ", %lluh %02llum %02llus left", s / 3600, s / 60 % 60, s % 60);
+    }
+    fprintf(stderr, "\n");
 }
 
-void after(struct dlx_data *data, struct dlx_node *r) {
-    struct row_data *row_data = r->row->row_data;
-    data->current_score -= row_data->weight;
-    data->graph &= ~row_data->flags;
-    data->k--;
+/**
+ * Maps the incumbent which is shared by the processes searching the shards of the tree, it starts
+ * at a score of 0 when the shared memory object is created. The object outlives the processes and
+ * has to be removed from /dev/shm once every shard is done.
+ *
+ * @param name[in] The name of the shared memory object.
+ * @return The shared incumbent or NULL if it couldn't be mapped.
+ */
+static _Atomic int *map_best(const char *name) {
+    /* Other processes only see the updates if they don't go through a lock of this process. */
+    _Static_assert(__atomic_always_lock_free(sizeof(_Atomic int), 0), "The best score needs lock-free atomics");
 
-    for(struct dlx_node *i = r->L; i != r; i = i->L)
-        for(struct dlx_node *j = i->C->U; j != i->C; j = j->U)
-            show(j->row);
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if(fd < 0) return NULL;
+    /* Extending the new object fills it with 0s, an object of this size is left as it is. */
+    void *best = ftruncate(fd, sizeof(_Atomic int)) ? MAP_FAILED :
+        mmap(NULL, sizeof(_Atomic int), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return best == MAP_FAILED ? NULL : best;
 }
 
-static uint64_t flood(uint64_t graph, unsigned node) {
-    uint64_t v = 1ull << node;
-    if(graph & v) return graph;
-    graph |= v;
-    return (graph = flood(graph, NEIGHBOUR_MATRIX[node][0])) |
-           (graph = flood(graph, NEIGHBOUR_MATRIX[node][1])) |
-           (graph = flood(graph, NEIGHBOUR_MATRIX[node][2])) |
-           (graph = flood(graph, NEIGHBOUR_MATRIX[node][3]));
-}
+/**
+ * Writes the statistics of the search as JSON if the file ends in .json and as CSV otherwise.
+ *
+ * @param file[in] The path of the statistics.
+ * @return True iff the statistics were written successfully.
+ */
+static bool write_stats(const char *file) {
+    size_t length = strlen(file);
+    enum dlx_stats_format format = length >= 5 && !strcmp(file + length - 5, ".json") ?
+        DLX_STATS_JSON : DLX_STATS_CSV;
 
-static bool flood_fill(struct dlx_data *d) {
-    if(d->k < 2 || d->k > 4) return false;
-    /* Find an empty tile in the graph. */
-    unsigned index = __builtin_ctzll(~d->graph);
-    return __builtin_popcountll(flood(d->graph, index)) % 5 != 0;
+    FILE *f = fopen(file, "w");
+    if(!f) return false;
+    bool result = dlx_write_stats(solver, f, format);
+    return !fclose(f) && result;
 }
 
-static bool sum_max(struct dlx_data *d) {
-    struct matrix_row *r = d->matrix;
-    double sum = d->current_score;
-    for(int i = 0; i < 12 - d->k; i++) {
-        struct row_data *rd = r->row_data;
-        sum += rd->weight;
-        r = r->next;
+int main(int argc, char *argv[]) {
+    int thread_count = 1;
+    enum dlx_backend backend = DLX_LINKS;
+    const char *checkpoint = NULL, *stats = NULL;
+    unsigned interval = 0;
+    enum sink_format format = SINK_TEXT;
+    double warm_start = 0;
+    int table_bits = TABLE_DEFAULT_BITS;
+    bool mitm = false;
+    /* The number of distinct packings to keep, 0 for all of the best ones or -1 to print as found. */
+    int top = -1;
+    /* The slice of the tree which is searched, see dlx_set_shard, and the name of the shared incumbent. */
+    int shard = 0, shard_count = 1, shard_depth = 3;
+    const char *shared = NULL;
+    /* The absolute and relative amount by which a branch has to be able to beat the best score. */
+    double epsilon = 0, relative_epsilon = 0;
+    /* The seconds between progress reports and after which the search is stopped, 0 for never. */
+    unsigned progress = 0, time_limit = 0;
+    /* The number of random paths of the tree size estimate, 0 to search the tree instead. */
+    int probes = 0;
+    /* The search stops once a packing reaches the target in sixths or after max_solutions packings, 0 for never. */
+    int target = 0;
+    uint64_t max_solutions = 0;
+
+    static const struct option options[] = {
+        { "threads", required_argument, NULL, 't' },
+        { "bitboard", no_argument, NULL, 'b' },
+        { "sparse", no_argument, NULL, 'x' },
+        { "checkpoint", required_argument, NULL, 'c' },
+        { "checkpoint-interval", required_argument, NULL, 'i' },
+        { "stats", required_argument, NULL, 's' },
+        { "format", required_argument, NULL, 'f' },
+        { "warm-start", required_argument, NULL, 'w' },
+        { "table", required_argument, NULL, 'T' },
+        { "mitm", no_argument, NULL, 'm' },
+        { "top", required_argument, NULL, 'k' },
+        { "all-optimal", no_argument, NULL, 'a' },
+        { "shard", required_argument, NULL, 'p' },
+        { "shard-depth", required_argument, NULL, 'd' },
+        { "shared-best", required_argument, NULL, 'g' },
+        { "epsilon", required_argument, NULL, 'e' },
+        { "progress", required_argument, NULL, 'P' },
+        { "time-limit", required_argument, NULL, 'L' },
+        { "estimate", required_argument, NULL, 'E' },
+        { "target", required_argument, NULL, 'G' },
+        { "solutions", required_argument, NULL, 'n' },
+        { NULL, 0, NULL, 0 }
+    };
+    for(int c; (c = getopt_long(argc, argv, "t:bxc:i:s:f:w:T:mk:ap:d:g:e:P:L:E:G:n:", options, NULL)) != -1; ) {
+        switch(c) {
+            case 't':
+                thread_count = atoi(optarg);
+                if(thread_count < 1) thread_count = 1;
+                break;
+            case 'b':
+                backend = DLX_BITBOARD;
+                break;
+            case 'x':
+                backend = DLX_SPARSE;
+                break;
+            case 'c':
+                checkpoint = optarg;
+                break;
+            case 'i':
+                interval = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                stats = optarg;
+                break;
+            case 'f':
+                format = !strcmp(optarg, "binary") ? SINK_BINARY : SINK_TEXT;
+                break;
+            case 'w':
+                warm_start = atof(optarg);
+                break;
+            case 'T':
+                table_bits = atoi(optarg);
+                if(table_bits > 40) table_bits = 40;
+                break;
+            case 'm':
+                mitm = true;
+                break;
+            case 'k':
+                top = atoi(optarg);
+                if(top < 1) top = 1;
+                break;
+            case 'a':
+                top = 0;
+                break;
+            case 'p':
+                if(sscanf(optarg, "%d/%d", &shard, &shard_count) != 2 || shard < 0 || shard >= shard_count) {
+                    fprintf(stderr, "Invalid shard, expected index/count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'd':
+                shard_depth = atoi(optarg);
+                if(shard_depth < 1) shard_depth = 1;
+                break;
+            case 'g':
+                shared = optarg;
+                break;
+            case 'e': {
+                /* A percentage is relative to the best score. */
+                char *end;
+                double value = strtod(optarg, &end);
+                if(value < 0) value = 0;
+                if(*end == '%') relative_epsilon = value / 100;
+                else epsilon = value;
+                break;
+            }
+            case 'P':
+                progress = strtoul(optarg, NULL, 10);
+                break;
+            case 'L':
+                time_limit = strtoul(optarg, NULL, 10);
+                break;
+            case 'E':
+                probes = atoi(optarg);
+                if(probes < 0) probes = 0;
+                break;
+            case 'G':
+                target = score_sixths(atof(optarg));
+                break;
+            case 'n':
+                max_solutions = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t threads] [-b | -x] [-c checkpoint [-i seconds]] [-s stats.{csv,json}] "
+                                "[-f text|binary] [-w seconds] [-T table bits] [-m] [-k count | -a] "
+                                "[-p index/count [-d depth]] [-g shared best] [-e epsilon[%%]] "
+                                "[-P seconds] [-L seconds] [-E probes] [-G score] [-n solutions]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(top >= 0 && (checkpoint || mitm)) {
+        fprintf(stderr, "The best distinct packings are neither kept in checkpoints nor by -m\n");
+        return 1;
+    }
+    if((epsilon > 0 || relative_epsilon > 0) && (top >= 0 || mitm)) {
+        fprintf(stderr, "Only the search for the best packing can be approximated\n");
+        return 1;
+    }
+    if(shard_count > 1 && mitm) {
+        fprintf(stderr, "The halves of -m can't be split into shards\n");
+        return 1;
     }
-    return sum < d->best_score;
-}
 
-static bool check_max(struct dlx_data *d) {
-    return (d->current_score + ((29.0 / 6.0) * (12 - d->k))) < d->best_score;
-}
+    static _Atomic int local_best;
+    _Atomic int *best = &local_best;
+    if(shared && !(best = map_best(shared))) {
+        fprintf(stderr, "Failed to map the shared best score: %s\n", shared);
+        return 1;
+    }
+
+    struct matrix_row *matrix = load_walks();
+    solver = packing_new(matrix, backend);
+    dlx_set_shard(solver, shard, shard_count, shard_depth);
+    struct sink *sink = sink_new(stdout, format, matrix, 4096);
+    /*
+     * Packings beating the k-th best score are kept without raising it, so it doesn't bound what
+     * the searched packings can add and the table has to be disabled.
+     */
+    struct table *table = table_bits > 0 && top <= 1 ? table_new(table_bits) : NULL;
+    struct topk *topk = top >= 0 ? topk_new(top, best) : NULL;
+
+    static _Atomic uint64_t found;
+    struct dlx_data *data = calloc_s(thread_count, sizeof(*data));
+    void *dlx_data[thread_count];
+    for(int i = 0; i < thread_count; i++) {
+        packing_data_init(&data[i], best, sink, table, topk);
+        packing_data_set_epsilon(&data[i], epsilon * 6, relative_epsilon);
+        packing_data_set_stop(&data[i], target > 0 ? target : 0, &found, max_solutions);
+        dlx_data[i] = &data[i];
+    }
+    /* The estimates of the progress reports try rows, which mustn't count as nodes of the search. */
+    struct dlx_data estimate_data;
+    packing_data_init(&estimate_data, best, NULL, table, NULL);
+    packing_data_set_epsilon(&estimate_data, epsilon * 6, relative_epsilon);
+
+    int result = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(checkpoint) {
+        /* Resume from the checkpoint if there is one. */
+        FILE *file = fopen(checkpoint, "rb");
+        if(file) {
+            int score;
+            if(!load_checkpoint(file, &score, &data[0].pruned_bound)) {
+                fprintf(stderr, "Invalid checkpoint: %s\n", checkpoint);
+                exit(1);
+            }
+            atomic_raise(best, score);
+            fclose(file);
+        }
+    }
+    if(checkpoint || progress || time_limit) {
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
+        signal(SIGALRM, signal_handler);
+    }
+
+    /* The k-th best packing may score less than the packing of the warm start. */
+    if(warm_start > 0 && top <= 1) {
+        /* The search still reports the packings tied with the incumbent. */
+        int score = packer_run(matrix, warm_start, 1);
+        fprintf(stderr, "Warm start: %f\n", score / 6.0);
+        atomic_raise(best, score);
+    }
+
+    if(probes) {
+        /* The heuristics prune against the incumbent, so the estimate is closer after a warm start. */
+        fprintf(stderr, "Estimated nodes: %.3e\n", dlx_estimate(solver, dlx_data[0], probes, 1));
+    } else if(mitm) {
+        if(!mitm_solve(matrix, best, sink, MITM_MAX_ENTRIES)) {
+            fprintf(stderr, "The packings of a half don't fit into %d entries\n", MITM_MAX_ENTRIES);
+            result = 1;
+        }
+    }
+
+    bool done = false, timed_out = false;
+    while(!mitm && !probes) {
+        /* Pause for the next checkpoint, progress report or the time limit, whichever comes first. */
+        unsigned pause = checkpoint ? interval : 0;
+        if(progress && (!pause || progress < pause)) pause = progress;
+        if(time_limit) {
+            double left = time_limit - elapsed(&start);
+            unsigned seconds = left >= 1 ? (unsigned) left : 1;
+            if(!pause || seconds < pause) pause = seconds;
+        }
+        alarm(pause);
+        done = thread_count == 1 ?
+            dlx_solve(solver, dlx_data[0]) : dlx_solve_parallel(solver, dlx_data, thread_count);
+        alarm(0);
+
+        if(done) {
+            if(checkpoint) remove(checkpoint);
+            break;
+        }
+        if(checkpoint && !save_checkpoint(checkpoint, atomic_load(best), pruned_bound(data, thread_count))) {
+            fprintf(stderr, "Failed to write checkpoint: %s\n", checkpoint);
+            result = 1;
+            break;
+        }
+        if(progress) {
+            uint64_t nodes = 0;
+            for(int i = 0; i < thread_count; i++)
+                nodes += data[i].nodes;
+            double left = dlx_estimate(solver, &estimate_data, PROGRESS_PROBES, nodes + 1);
+            report_progress(dlx_remaining(solver), left, elapsed(&start), nodes);
+        }
+        /* Another shard may have reached the target through the shared best score. */
+        if(interrupted || (target > 0 && atomic_load(best) >= target) ||
+           (max_solutions && atomic_load(&found) >= max_solutions))
+            break;
+        if(time_limit && elapsed(&start) >= time_limit) {
+            timed_out = true;
+            break;
+        }
+    }
+
+    if(timed_out || (done && (epsilon > 0 || relative_epsilon > 0))) {
+        /*
+         * Every branch which wasn't searched was bounded by the best score or the pruned bound, or
+         * is one of the branches which are left.
+         */
+        int score = atomic_load(best), bound = pruned_bound(data, thread_count);
+        if(timed_out) {
+            int left = (int) dlx_bound(solver, dlx_data[0], (dlx_bound_callback) packing_bound);
+            if(left > bound) bound = left;
+        }
+        int gap = bound > score ? bound - score : 0;
+        fprintf(stderr, "%sBest: %f, the optimum is at most %f (gap %f, %.2f%%)\n",
+                timed_out ? "Time limit reached. " : "", score / 6.0, (score + gap) / 6.0, gap / 6.0,
+                score > 0 ? 100.0 * gap / score : 0);
+    }
+
+    if(stats && !write_stats(stats)) {
+        fprintf(stderr, "Failed to write statistics, the solver must be built with DLX_STATS: %s\n", stats);
+        result = 1;
+    }
+    packing_free(solver);
 
-int main() {
-    struct matrix_row *matrix = generate_walks();
-    struct dlx_solver *solver = dlx_new(72);
-    for(struct matrix_row *i = matrix; i; i = i->next)
-        dlx_row(solver, i);
-
-    dlx_set_callback(solver, solution_callback);
-    dlx_set_ba(solver, (dlx_data_callback) before,
-                       (dlx_data_callback) after);
-
-    dlx_add_heuristic(solver, (dlx_heuristic_callback) flood_fill);
-    dlx_add_heuristic(solver, (dlx_heuristic_callback) sum_max);
-    dlx_add_heuristic(solver, (dlx_heuristic_callback) check_max);
-
-    static struct dlx_data data;
-    data.matrix = matrix;
-
-    dlx_solve(solver, &data);
-    dlx_free(solver);
-
-    /* Free the matrix. */
-    while(matrix) {
-        struct matrix_row *tmp = matrix;
-        matrix = matrix->next;
-        free(tmp->row_data);
-        free(tmp->row);
-        free(tmp);
+    if(topk) {
+        topk_write(topk, sink);
+        topk_free(topk);
     }
+    sink_free(sink);
+    for(int i = 0; i < thread_count; i++)
+        packing_data_free(&data[i]);
+    packing_data_free(&estimate_data);
+    free(data);
+    if(table) table_free(table);
+    if(shared) munmap((void *) best, sizeof(*best));
+    return result;
 }
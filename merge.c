@@ -0,0 +1,220 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cube.h"
+#include "dlx.h"
+#include "globals.h"
+#include "sink.h"
+#include "topk.h"
+
+/* A solution which was read from one of the outputs and its score in sixths. */
+struct solution {
+    int score;
+    int count;
+    struct matrix_row *rows[SINK_ROWS];
+};
+
+/* The solutions of every output and the rows of the matrix indexed by their id. */
+struct merge {
+    struct solution *solutions;
+    int size, capacity;
+    struct matrix_row **rows;
+    int row_count;
+};
+
+/**
+ * @param merge[in] The solutions to which a solution is to be added.
+ * @param score The score of the solution as it was written.
+ *
+ * @return The new solution without any rows.
+ */
+static struct solution *merge_add(struct merge *merge, double score) {
+    if(merge->size == merge->capacity) {
+        merge->capacity = merge->capacity ? merge->capacity * 2 : 64;
+        merge->solutions = realloc_s(merge->solutions, merge->capacity * sizeof(*merge->solutions));
+    }
+    struct solution *s = &merge->solutions[merge->size++];
+    s->score = score_sixths(score), s->count = 0;
+    return s;
+}
+
+/**
+ * Reads solutions written in the binary format of the sink, the magic has already been read.
+ *
+ * @param merge[in] The solutions to which they are to be added.
+ * @param input[in] The stream of solutions.
+ *
+ * @return True iff the stream was read successfully.
+ */
+static bool read_binary(struct merge *merge, FILE *input) {
+    uint32_t count;
+    if(fread(&count, sizeof(count), 1, input) != 1 || count != (uint32_t) merge->row_count)
+        return false;
+
+    for(double score; fread(&score, sizeof(score), 1, input) == 1; ) {
+        uint8_t size;
+        uint16_t ids[SINK_ROWS];
+        if(fread(&size, sizeof(size), 1, input) != 1 || size > SINK_ROWS ||
+           fread(ids, sizeof(*ids), size, input) != size)
+            return false;
+
+        struct solution *s = merge_add(merge, score);
+        for(int i = 0; i < size; i++) {
+            if(ids[i] >= merge->row_count)
+                return false;
+            s->rows[s->count++] = merge->rows[ids[i]];
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads solutions written in the text format of the sink, each row is looked up by its tiles and
+ * its piece.
+ *
+ * @param merge[in] The solutions to which they are to be added.
+ * @param input[in] The stream of solutions.
+ *
+ * @return True iff the stream was read successfully.
+ */
+static bool read_text(struct merge *merge, FILE *input) {
+    struct solution *s = NULL;
+    for(char line[512]; fgets(line, sizeof(line), input); ) {
+        double score;
+        if(sscanf(line, "Score: %lf", &score) == 1) {
+            s = merge_add(merge, score);
+            continue;
+        }
+
+        uint64_t columns[2] = { };
+        int length = 0;
+        for(char *i = line, *end; ; i = end) {
+            while(*i == ' ') i++;
+            bool piece = *i == '[';
+            long column = strtol(i + piece, &end, 10);
+            if(end == i + piece) break;
+            if(piece) column += 60, end++;
+            if(column < 0 || column >= 72) return false;
+            columns[column >> 6] |= 1llu << (column & 63);
+            length++;
+        }
+        if(!length) continue;
+        if(!s || s->count == SINK_ROWS) return false;
+
+        int r = 0;
+        while(r < merge->row_count &&
+              (merge->rows[r]->row[0] != columns[0] || merge->rows[r]->row[1] != columns[1])) r++;
+        if(r == merge->row_count) return false;
+        s->rows[s->count++] = merge->rows[r];
+    }
+    return true;
+}
+
+/**
+ * @param s[in] The solution whose rows are to be linked.
+ * @param links[out] The storage of the list, which needs room for every row.
+ *
+ * @return The rows of the solution as a list like the search reports them.
+ */
+static struct dlx_solution *solution_list(struct solution *s, struct dlx_solution *links) {
+    struct dlx_solution *list = NULL;
+    for(int i = s->count - 1; i >= 0; i--)
+        links[i].row = s->rows[i], links[i].next = list, list = &links[i];
+    return list;
+}
+
+/*
+ * Combines the outputs of the processes which searched the shards of the tree, in either format of
+ * the sink, into the packings tied for the best score or the best distinct packings.
+ */
+int main(int argc, char *argv[]) {
+    enum sink_format format = SINK_TEXT;
+    /* The number of distinct packings to keep, 0 for all of the best ones or -1 for every best one. */
+    int top = -1;
+    for(int c; (c = getopt(argc, argv, "f:k:a")) != -1; ) {
+        switch(c) {
+            case 'f':
+                format = !strcmp(optarg, "binary") ? SINK_BINARY : SINK_TEXT;
+                break;
+            case 'k':
+                top = atoi(optarg);
+                if(top < 1) top = 1;
+                break;
+            case 'a':
+                top = 0;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-f text|binary] [-k count | -a] solutions...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    /* Index the rows by their id. */
+    struct merge merge = { };
+    struct matrix_row *matrix = load_walks();
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        merge.row_count++;
+    merge.rows = malloc_s(merge.row_count * sizeof(*merge.rows));
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        merge.rows[((struct row_data *) i->row_data)->id] = i;
+
+    for(int i = optind; i < argc; i++) {
+        FILE *input = fopen(argv[i], "rb");
+        if(!input) {
+            fprintf(stderr, "Failed to open: %s\n", argv[i]);
+            return 1;
+        }
+        char magic[sizeof(SINK_MAGIC) - 1];
+        bool binary = fread(magic, 1, sizeof(magic), input) == sizeof(magic) &&
+                      !memcmp(magic, SINK_MAGIC, sizeof(magic));
+        if(!binary) rewind(input);
+        if(!(binary ? read_binary(&merge, input) : read_text(&merge, input))) {
+            fprintf(stderr, "Not a stream of solutions of this build: %s\n", argv[i]);
+            return 1;
+        }
+        fclose(input);
+    }
+
+    struct sink *sink = sink_new(stdout, format, matrix, 4096);
+    struct dlx_solution links[SINK_ROWS];
+    if(top >= 0) {
+        _Atomic int threshold = 0;
+        struct topk *topk = topk_new(top, &threshold);
+        for(int i = 0; i < merge.size; i++)
+            topk_add(topk, merge.solutions[i].score, solution_list(&merge.solutions[i], links));
+        topk_write(topk, sink);
+        topk_free(topk);
+    } else {
+        /* The shards report the packings tied for the best score they knew of at the time. */
+        int best = 0;
+        for(int i = 0; i < merge.size; i++)
+            if(merge.solutions[i].score > best) best = merge.solutions[i].score;
+        for(int i = 0; i < merge.size; i++)
+            if(merge.solutions[i].score == best)
+                sink_put(sink, merge.solutions[i].score, solution_list(&merge.solutions[i], links));
+    }
+    sink_free(sink);
+
+    free(merge.solutions);
+    free(merge.rows);
+    return 0;
+}
@@ -0,0 +1,304 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mitm.h"
+
+#include "cube.h"
+#include "globals.h"
+
+/* The tiles of the cube. */
+#define ALL_TILES ((1llu << 60) - 1)
+
+/* A packing of one half of the pieces and its score in sixths. */
+struct half {
+    uint64_t tiles;
+    int score;
+    int16_t rows[6];
+    /* One more than the index in ties of the next packing of the same tiles and score, 0 for none. */
+    int32_t tie;
+};
+
+struct mitm {
+    struct matrix_row **rows;
+    /* The tiles and weight of each row. */
+    uint64_t *flags;
+    uint8_t *weights;
+    /* The rows of each piece. */
+    int *piece_rows[12], piece_size[12];
+    uint64_t neighbours[60];
+
+    /* The pieces of the half which is being enumerated, ordered by their number of rows. */
+    int pieces[6], piece_count;
+    /* The highest score of the pieces from each index of pieces onwards. */
+    int rest[7];
+    /* The highest score which the other half can add. */
+    int other;
+
+    /* The packings of the stored half, hashed by their tiles. */
+    struct half *table;
+    size_t table_size, table_mask, max_entries;
+    bool full;
+    /* The packings which tie with the packing of the table covering the same tiles. */
+    struct half *ties;
+    size_t tie_count, tie_capacity;
+
+    _Atomic int *best_score;
+    struct sink *sink;
+    /* The packing of the enumerated half. */
+    struct half current;
+};
+
+/**
+ * @param tiles The tiles which are to be hashed.
+ * @return The hash of the tiles.
+ */
+static inline uint64_t mitm_hash(uint64_t tiles) {
+    tiles = (tiles ^ tiles >> 30) * 0xbf58476d1ce4e5b9llu;
+    tiles = (tiles ^ tiles >> 27) * 0x94d049bb133111ebllu;
+    return tiles ^ tiles >> 31;
+}
+
+/**
+ * @param m[in] The solver whose table is to be searched.
+ * @param tiles The tiles of the packing.
+ *
+ * @return The entry of the packing covering the tiles or the empty entry where it belongs.
+ */
+static struct half *table_find(struct mitm *m, uint64_t tiles) {
+    for(size_t i = mitm_hash(tiles) & m->table_mask; ; i = (i + 1) & m->table_mask)
+        if(!m->table[i].tiles || m->table[i].tiles == tiles)
+            return &m->table[i];
+}
+
+/**
+ * Keeps the given packing if it beats or ties with the stored packings covering the same tiles.
+ *
+ * @param m[in,out] The solver whose table is to be updated.
+ * @param h[in] The packing which is to be stored, which has no ties.
+ */
+static void table_add(struct mitm *m, struct half *h) {
+    struct half *e = table_find(m, h->tiles);
+    if(e->tiles && h->score < e->score)
+        return;
+    /* A better packing drops the ties of the stored one, their entries aren't reused. */
+    if(e->tiles && h->score > e->score) {
+        *e = *h;
+        return;
+    }
+    if(m->table_size + m->tie_count >= m->max_entries) {
+        m->full = true;
+        return;
+    }
+    if(e->tiles) {
+        if(m->tie_count == m->tie_capacity) {
+            m->tie_capacity = m->tie_capacity ? m->tie_capacity * 2 : 64;
+            m->ties = realloc_s(m->ties, m->tie_capacity * sizeof(*m->ties));
+        }
+        m->ties[m->tie_count] = *h;
+        m->ties[m->tie_count].tie = e->tie;
+        e->tie = (int32_t) ++m->tie_count;
+        return;
+    }
+    *e = *h;
+
+    /* Keep the load factor below one half. */
+    if(++m->table_size * 2 > m->table_mask + 1) {
+        struct half *old = m->table;
+        size_t capacity = m->table_mask + 1;
+        m->table_mask = capacity * 2 - 1;
+        m->table = calloc_s(capacity * 2, sizeof(*m->table));
+        for(size_t i = 0; i < capacity; i++)
+            if(old[i].tiles)
+                *table_find(m, old[i].tiles) = old[i];
+        free(old);
+    }
+}
+
+/**
+ * @param m[in] The solver which is to be used.
+ * @param used The tiles which are covered.
+ *
+ * @return True iff an empty region can't be covered by pentominoes.
+ */
+static bool dead_region(struct mitm *m, uint64_t used) {
+    uint64_t empty = ~used & ALL_TILES;
+    while(empty) {
+        uint64_t component = empty & -empty, frontier = component;
+        while(frontier) {
+            uint64_t next = 0;
+            for(; frontier; frontier &= frontier - 1)
+                next |= m->neighbours[__builtin_ctzll(frontier)];
+            frontier = next & empty & ~component;
+            component |= frontier;
+        }
+        if(__builtin_popcountll(component) % 5 != 0)
+            return true;
+        empty &= ~component;
+    }
+    return false;
+}
+
+/**
+ * Reports the packing made of the current packing and the stored packing of the other half.
+ *
+ * @param m[in] The solver which is to be used.
+ * @param other[in] The stored packing of the other half.
+ */
+static void report(struct mitm *m, struct half *other) {
+    int score = m->current.score + other->score;
+    atomic_raise(m->best_score, score);
+    if(!m->sink || score != atomic_load(m->best_score))
+        return;
+
+    struct dlx_solution solution[12], *next = NULL;
+    int count = 0;
+    for(int i = 0; i < m->piece_count; i++)
+        solution[count] = (struct dlx_solution) { m->rows[m->current.rows[i]], next }, next = &solution[count++];
+    for(int i = 0; i < 6 && other->rows[i] >= 0; i++)
+        solution[count] = (struct dlx_solution) { m->rows[other->rows[i]], next }, next = &solution[count++];
+    sink_push(m->sink, score, next);
+}
+
+/**
+ * Enumerates the packings of the pieces from the given index onwards, either storing them or
+ * joining them with the stored packings.
+ *
+ * @param m[in,out] The solver which is to be used.
+ * @param index The index of the next piece which is to be placed.
+ * @param join Whether the packings are to be joined rather than stored.
+ */
+static void enumerate(struct mitm *m, int index, bool join) {
+    if(m->full) return;
+    if(index == m->piece_count) {
+        if(!join) {
+            table_add(m, &m->current);
+            return;
+        }
+        struct half *other = table_find(m, ~m->current.tiles & ALL_TILES);
+        for(; other && other->tiles; other = other->tie ? &m->ties[other->tie - 1] : NULL)
+            report(m, other);
+        return;
+    }
+
+    int piece = m->pieces[index];
+    for(int i = 0; i < m->piece_size[piece]; i++) {
+        int id = m->piece_rows[piece][i];
+        uint64_t flags = m->flags[id];
+        if(flags & m->current.tiles) continue;
+
+        /* The rows are sorted by weight, so none of the remaining rows can beat the best score. */
+        int score = m->current.score + m->weights[id];
+        if(score + m->rest[index + 1] + m->other < atomic_load(m->best_score)) break;
+        if(dead_region(m, m->current.tiles | flags)) continue;
+
+        struct half saved = m->current;
+        m->current.tiles |= flags, m->current.score = score;
+        m->current.rows[index] = id;
+        enumerate(m, index + 1, join);
+        m->current = saved;
+    }
+}
+
+/**
+ * Prepares the enumeration of the given pieces.
+ *
+ * @param m[in,out] The solver which is to be used.
+ * @param pieces[in] The pieces of the half.
+ * @param count The number of pieces.
+ * @param other The highest score which the other half can add.
+ */
+static void set_half(struct mitm *m, const int *pieces, int count, int other) {
+    m->piece_count = count;
+    m->other = other;
+    m->rest[count] = 0;
+    for(int i = count - 1; i >= 0; i--) {
+        m->pieces[i] = pieces[i];
+        m->rest[i] = m->rest[i + 1] + m->weights[m->piece_rows[pieces[i]][0]];
+    }
+    m->current = (struct half) { .rows = { -1, -1, -1, -1, -1, -1 } };
+}
+
+bool mitm_solve(struct matrix_row *matrix, _Atomic int *best_score, struct sink *sink, size_t max_entries) {
+    struct mitm m = { .best_score = best_score, .sink = sink, .max_entries = max_entries };
+    int row_count = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        row_count++;
+    m.rows = malloc_s(row_count * sizeof(*m.rows));
+    m.flags = malloc_s(row_count * sizeof(*m.flags));
+    m.weights = malloc_s(row_count * sizeof(*m.weights));
+    for(int i = 0; i < 12; i++)
+        m.piece_rows[i] = malloc_s(row_count * sizeof(*m.piece_rows[i]));
+
+    /* Index the rows by their piece, the matrix is sorted by weight already. */
+    int id = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next, id++) {
+        struct row_data *data = i->row_data;
+        m.rows[id] = i, m.flags[id] = data->flags, m.weights[id] = data->weight;
+        for(int j = 0; j < 12; j++)
+            if(dlx_has(i, j + 60))
+                m.piece_rows[j][m.piece_size[j]++] = id;
+    }
+    for(int i = 0; i < 60; i++)
+        for(int j = 0; j < 4; j++)
+            m.neighbours[i] |= 1llu << (unsigned) NEIGHBOUR_MATRIX[i][j];
+
+    /* Order the pieces by their number of rows and deal them out to the halves alternately. */
+    int order[12];
+    for(int i = 0; i < 12; i++) {
+        int j = i;
+        for(; j > 0 && m.piece_size[order[j - 1]] > m.piece_size[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    bool possible = true;
+    int halves[2][6];
+    int max[2] = { 0, 0 };
+    for(int i = 0; i < 12; i++) {
+        int piece = order[i];
+        halves[i % 2][i / 2] = piece;
+        if(m.piece_size[piece]) max[i % 2] += m.weights[m.piece_rows[piece][0]];
+        else possible = false;
+    }
+
+    bool done = true;
+    if(possible) {
+        /* Store the half with more rows, the other one is pruned by the stored packings. */
+        m.table_mask = 1023;
+        m.table = calloc_s(m.table_mask + 1, sizeof(*m.table));
+        set_half(&m, halves[1], 6, max[0]);
+        enumerate(&m, 0, false);
+        done = !m.full;
+
+        if(done) {
+            int stored = 0;
+            for(size_t i = 0; i <= m.table_mask; i++)
+                if(m.table[i].tiles && m.table[i].score > stored)
+                    stored = m.table[i].score;
+            set_half(&m, halves[0], 6, stored);
+            enumerate(&m, 0, true);
+        }
+        free(m.table);
+        free(m.ties);
+    }
+
+    for(int i = 0; i < 12; i++)
+        free(m.piece_rows[i]);
+    free(m.rows);
+    free(m.flags);
+    free(m.weights);
+    return done;
+}
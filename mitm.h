@@ -0,0 +1,52 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MITM_H
+#define MITM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dlx.h"
+#include "sink.h"
+
+/*
+ * The default number of packings of a half which may be stored. The entries take 32 bytes and the
+ * table is kept at most half full, so a packing takes 64 to 128 bytes and a tie another 32 to 64,
+ * which is about 1 to 2 GB at this limit.
+ */
+#define MITM_MAX_ENTRIES (1 << 24)
+
+/**
+ * Searches for the packings with the highest score by splitting the pieces into two halves. The
+ * packings of one half are stored by their tiles, those of the other half are enumerated and
+ * joined with the stored packing covering the remaining tiles. Both halves are pruned by the
+ * best score and by empty regions whose size isn't a multiple of 5. The best packings of the stored
+ * half are kept for each set of tiles along with their ties, so every packing tied for the best
+ * score is reported like by the search.
+ *
+ * @param matrix[in] The rows of the cover matrix.
+ * @param best_score[in,out] The best score in sixths found so far, which is raised by the search.
+ * @param sink[in] The sink to which the best packings are written or NULL.
+ * @param max_entries The most packings of a half which may be stored.
+ *
+ * @return True iff the search completed, false if it ran out of entries.
+ */
+bool mitm_solve(struct matrix_row *matrix, _Atomic int *best_score, struct sink *sink, size_t max_entries);
+
+#endif /* MITM_H */
@@ -0,0 +1,284 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "packer.h"
+
+#include <math.h>
+#include <time.h>
+
+#include "cube.h"
+#include "globals.h"
+
+/* The tiles of the cube. */
+#define ALL_TILES ((1llu << 60) - 1)
+
+/* The tiles, the piece and the weight in sixths of a row. */
+struct packer_row {
+    uint64_t flags;
+    int piece, weight;
+};
+
+/* A set of rows which don't intersect and its score in sixths. */
+struct packing {
+    uint64_t tiles;
+    uint32_t pieces;
+    int rows[12], count;
+    int score;
+};
+
+struct packer {
+    struct packer_row *rows;
+    /* The rows containing each of the tiles, sorted by weight. */
+    int *tile_rows[60], tile_size[60];
+    uint64_t neighbours[60];
+    uint64_t random;
+
+    /* The number of nodes complete may still visit. */
+    int budget;
+    /* Stop at the first packing covering every tile rather than looking for the best one. */
+    bool first;
+    /* The amount of random noise in sixths added to the weights when ordering the rows. */
+    double noise;
+    /* The best completion which was found. */
+    struct packing best;
+    bool found;
+    /* The highest weight of the rows of each piece. */
+    int piece_max[12];
+};
+
+/**
+ * @return A monotonic timestamp in seconds.
+ */
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * @param p[in,out] The packer whose generator is to be advanced.
+ * @return A pseudo random number.
+ */
+static inline uint64_t next_random(struct packer *p) {
+    p->random ^= p->random << 13;
+    p->random ^= p->random >> 7;
+    p->random ^= p->random << 17;
+    return p->random;
+}
+
+/**
+ * @param p[in,out] The packer whose generator is to be advanced.
+ * @return A pseudo random number in [0, 1).
+ */
+static inline double next_uniform(struct packer *p) {
+    return (next_random(p) >> 11) * (1.0 / (1llu << 53));
+}
+
+/**
+ * @param p[in] The packer which is to be used.
+ * @param s[in] The packing to which the row would be added.
+ * @param id The index of the row.
+ *
+ * @return True iff the row neither intersects the tiles nor the pieces of the packing.
+ */
+static inline bool row_fits(struct packer *p, struct packing *s, int id) {
+    return !(p->rows[id].flags & s->tiles) && !(s->pieces & 1u << p->rows[id].piece);
+}
+
+/**
+ * @param p[in] The packer which is to be used.
+ * @param s[in,out] The packing to which the row is to be added.
+ * @param id The index of the row.
+ */
+static inline void packing_add(struct packer *p, struct packing *s, int id) {
+    s->tiles |= p->rows[id].flags, s->pieces |= 1u << p->rows[id].piece;
+    s->rows[s->count++] = id, s->score += p->rows[id].weight;
+}
+
+/**
+ * Completes the packing so that every tile is covered, recording the result in p->best. The
+ * rows are tried by their weight with p->noise added to it, on the tile with the fewest candidates.
+ *
+ * @param p[in,out] The packer which is to be used.
+ * @param s[in] The packing which is to be completed.
+ */
+static void complete(struct packer *p, struct packing *s) {
+    if(p->budget-- <= 0 || (p->first && p->found)) return;
+    if(s->tiles == ALL_TILES) {
+        if(!p->found || s->score > p->best.score)
+            p->best = *s, p->found = true;
+        return;
+    }
+
+    /* The remaining pieces can't beat the best completion. */
+    if(!p->first && p->found) {
+        int bound = s->score;
+        for(int i = 0; i < 12; i++)
+            if(!(s->pieces & 1u << i)) bound += p->piece_max[i];
+        if(bound <= p->best.score) return;
+    }
+
+    /* The empty tile with the fewest rows which fit. */
+    int tile = -1, min = 1 << 30;
+    for(uint64_t empty = ~s->tiles & ALL_TILES; empty; empty &= empty - 1) {
+        int t = __builtin_ctzll(empty), count = 0;
+        for(int i = 0; i < p->tile_size[t] && count < min; i++)
+            count += row_fits(p, s, p->tile_rows[t][i]);
+        if(count < min) min = count, tile = t;
+        if(!min) return;
+    }
+
+    int candidates[min];
+    double keys[min];
+    int count = 0;
+    for(int i = 0; i < p->tile_size[tile]; i++) {
+        int id = p->tile_rows[tile][i];
+        if(!row_fits(p, s, id)) continue;
+
+        /* Insert the row by its perturbed weight. */
+        double key = p->rows[id].weight + p->noise * next_uniform(p);
+        int j = count++;
+        for(; j > 0 && keys[j - 1] < key; j--)
+            keys[j] = keys[j - 1], candidates[j] = candidates[j - 1];
+        keys[j] = key, candidates[j] = id;
+    }
+
+    for(int i = 0; i < count; i++) {
+        struct packing next = *s;
+        packing_add(p, &next, candidates[i]);
+        complete(p, &next);
+    }
+}
+
+/**
+ * @param p[in,out] The packer which is to be used.
+ * @param s[in] The packing which is to be completed.
+ * @param first Whether to stop at the first completion.
+ * @param noise The amount of noise in sixths added to the weights.
+ * @param budget The number of nodes which may be visited.
+ * @param result[out] The completion which was found.
+ *
+ * @return True iff a completion was found.
+ */
+static bool run_complete(struct packer *p, struct packing *s, bool first, double noise, int budget,
+                         struct packing *result) {
+    p->first = first, p->noise = noise, p->budget = budget, p->found = false;
+    complete(p, s);
+    *result = p->best;
+    return p->found;
+}
+
+/**
+ * Removes a few adjacent rows from the packing.
+ *
+ * @param p[in,out] The packer which is to be used.
+ * @param s[in] The packing covering every tile.
+ * @param count The number of rows which are to be removed.
+ * @param result[out] The packing without the removed rows.
+ */
+static void destroy(struct packer *p, struct packing *s, int count, struct packing *result) {
+    bool removed[12] = { };
+    uint64_t region = 0;
+    for(int k = 0; k < count; k++) {
+        /* The tiles next to the removed ones. */
+        uint64_t border = 0;
+        for(uint64_t r = region; r; r &= r - 1)
+            border |= p->neighbours[__builtin_ctzll(r)];
+        border &= ~region;
+
+        int options[12], n = 0;
+        for(int i = 0; i < s->count; i++)
+            if(!removed[i] && (!region || (p->rows[s->rows[i]].flags & border)))
+                options[n++] = i;
+        if(!n) break;
+        int i = options[next_random(p) % n];
+        removed[i] = true;
+        region |= p->rows[s->rows[i]].flags;
+    }
+
+    *result = (struct packing) { };
+    for(int i = 0; i < s->count; i++)
+        if(!removed[i])
+            packing_add(p, result, s->rows[i]);
+}
+
+int packer_run(struct matrix_row *matrix, double seconds, uint64_t seed) {
+    struct packer p = { .random = seed ? seed : 1 };
+    int row_count = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        row_count++;
+    p.rows = malloc_s(row_count * sizeof(*p.rows));
+
+    /* Index the rows by their tiles, the matrix is sorted by weight already. */
+    for(int i = 0; i < 60; i++)
+        p.tile_rows[i] = malloc_s(row_count * sizeof(*p.tile_rows[i]));
+    int id = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next, id++) {
+        struct row_data *data = i->row_data;
+        p.rows[id] = (struct packer_row) { data->flags, 0, data->weight };
+        for(int j = 0; j < 12; j++)
+            if(dlx_has(i, j + 60)) p.rows[id].piece = j;
+        if(data->weight > p.piece_max[p.rows[id].piece])
+            p.piece_max[p.rows[id].piece] = data->weight;
+        for(uint64_t f = data->flags; f; f &= f - 1) {
+            int t = __builtin_ctzll(f);
+            p.tile_rows[t][p.tile_size[t]++] = id;
+        }
+    }
+    for(int i = 0; i < 60; i++)
+        for(int j = 0; j < 4; j++)
+            p.neighbours[i] |= 1llu << (unsigned) NEIGHBOUR_MATRIX[i][j];
+
+    double start = now();
+    int best = 0;
+    struct packing current = { }, empty = { };
+    bool valid = false;
+    int stale = 0, budget = 2000;
+    while(now() - start < seconds) {
+        /* Restart from a new greedy packing if the current one stopped improving. */
+        if(!valid || stale > 2000) {
+            valid = run_complete(&p, &empty, true, 3, budget, &current);
+            /* Allow harder instances more nodes for the next attempt. */
+            if(!valid && budget < 1 << 24) budget *= 2;
+            stale = 0;
+            if(valid && current.score > best) best = current.score;
+            continue;
+        }
+
+        /* Refill the tiles of a few adjacent rows with the best rows which fit. */
+        struct packing partial, refill;
+        destroy(&p, &current, 4 + next_random(&p) % 4, &partial);
+        if(!run_complete(&p, &partial, false, 0, 20000, &refill))
+            continue;
+        if(refill.score > current.score) {
+            current = refill, stale = 0;
+        } else {
+            /* Accept a random refill which is worse with a probability falling over time. */
+            double temperature = 3 * (1 - (now() - start) / seconds);
+            if(run_complete(&p, &partial, true, 30, 20000, &refill) && temperature > 0 &&
+               next_uniform(&p) < exp((refill.score - current.score) / temperature))
+                current = refill;
+            stale++;
+        }
+        if(current.score > best) best = current.score;
+    }
+
+    for(int i = 0; i < 60; i++)
+        free(p.tile_rows[i]);
+    free(p.rows);
+    return best;
+}
@@ -0,0 +1,37 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACKER_H
+#define PACKER_H
+
+#include "dlx.h"
+
+/**
+ * Looks for a packing with a high score within the given time, which is used as the incumbent of
+ * the exact search. Packings are built greedily by weight with randomised restarts and improved by
+ * removing a few adjacent pieces and refilling their tiles, accepting worse refills by simulated
+ * annealing.
+ *
+ * @param matrix[in] The rows of the cover matrix.
+ * @param seconds The time the packer may take.
+ * @param seed The seed of the random choices.
+ *
+ * @return The highest score in sixths of the packings which were found or 0 if there are none.
+ */
+int packer_run(struct matrix_row *matrix, double seconds, uint64_t seed);
+
+#endif /* PACKER_H */
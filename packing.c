@@ -0,0 +1,426 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "packing.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include "cube.h"
+#include "globals.h"
+
+/* The ids of the rows containing each of the columns. */
+static struct column {
+    int *rows, size;
+} columns[72];
+
+/* The tiles, the piece, the weight and the face on which it is scored of each row indexed by its id. */
+static struct row_info {
+    uint64_t flags;
+    int piece, sixths, face;
+    /* The area of the row on each face in sixths. */
+    uint8_t area[6];
+} *rows;
+
+/* The tiles adjacent to each of the tiles. */
+static uint64_t neighbours[60];
+
+/* The number of rows of the solver. */
+static int row_count;
+
+/**
+ * @param data[in] The data of the current thread.
+ * @return The best score which has been found so far.
+ */
+static inline int best_score(struct dlx_data *data) {
+    return atomic_load_explicit(data->best_score, memory_order_relaxed);
+}
+
+static bool solution_callback(struct dlx_context *context) {
+    struct dlx_data *data = context->dlx_data;
+    if(data->topk) {
+        topk_add(data->topk, data->current_score, context->solution);
+    } else {
+        atomic_raise(data->best_score, data->current_score);
+
+        /* The output is written by the sink's thread so that the search never waits for it. */
+        if(data->sink && data->current_score == best_score(data))
+            sink_push(data->sink, data->current_score, context->solution);
+    }
+
+    /* Stop once the packing is good enough or enough packings have been found. */
+    return (data->stop_score > 0 && data->current_score >= data->stop_score) ||
+           (data->found && atomic_fetch_add_explicit(data->found, 1, memory_order_relaxed) + 1 >= data->stop_count);
+}
+
+/**
+ * @param weights The weights in sixths for which a piece has live rows.
+ * @return The maximum of the weights or 0 if there are none.
+ */
+static inline int max_weight(uint32_t weights) {
+    return weights ? 31 - __builtin_clz(weights) : 0;
+}
+
+/**
+ * Removes a row from the live rows of its piece and updates the bound.
+ *
+ * @param data[in,out] The data of the current thread.
+ * @param id The id of the row which is to be hidden.
+ */
+static inline void hide(struct dlx_data *data, int id) {
+    struct row_info *r = &rows[id];
+    if(!--data->face_live[r->piece][r->face][r->sixths])
+        data->face_weights[r->piece][r->face] &= ~(1u << r->sixths);
+    if(--data->live[r->piece][r->sixths]) return;
+
+    uint32_t *weights = &data->weights[r->piece];
+    int max = max_weight(*weights);
+    *weights &= ~(1u << r->sixths);
+    data->bound += max_weight(*weights) - max;
+    if(!*weights) data->empty++;
+}
+
+/**
+ * Adds a row to the live rows of its piece and updates the bound.
+ *
+ * @param data[in,out] The data of the current thread.
+ * @param id The id of the row which is to be shown.
+ */
+static inline void show(struct dlx_data *data, int id) {
+    struct row_info *r = &rows[id];
+    if(!data->face_live[r->piece][r->face][r->sixths]++)
+        data->face_weights[r->piece][r->face] |= 1u << r->sixths;
+    if(data->live[r->piece][r->sixths]++) return;
+
+    uint32_t *weights = &data->weights[r->piece];
+    if(!*weights) data->empty--;
+    int max = max_weight(*weights);
+    *weights |= 1u << r->sixths;
+    data->bound += max_weight(*weights) - max;
+}
+
+/**
+ * @param tiles The tiles whose area is to be summed.
+ * @param face The face on which the area is measured.
+ *
+ * @return The area of the tiles on the face in sixths.
+ */
+static int face_area(uint64_t tiles, int face) {
+    int area = 0;
+    for(; tiles; tiles &= tiles - 1)
+        area += AREA_MATRIX[__builtin_ctzll(tiles)][face];
+    return area;
+}
+
+/**
+ * @param r[in] A row of the cover matrix.
+ * @return The position of the row in the weight sorted matrix.
+ */
+static inline int row_id(struct matrix_row *r) {
+    return ((struct row_data *) r->row_data)->id;
+}
+
+static void before(struct dlx_data *data, struct matrix_row *r) {
+    struct row_data *row_data = r->row_data;
+    data->nodes++;
+    data->current_score += row_data->weight;
+    data->graph |= row_data->flags;
+    data->pieces |= 1u << rows[row_id(r)].piece;
+    data->hidden_depth[data->k++] = data->hidden_count;
+    for(int f = 0; f < 6; f++)
+        data->area[f] -= rows[row_id(r)].area[f];
+
+    /* Hide every row which intersects the chosen row. */
+    for(int w = 0; w < dlx_words(72); w++) {
+        for(uint64_t bits = r->row[w]; bits; bits &= bits - 1) {
+            struct column *c = &columns[w * 64 + __builtin_ctzll(bits)];
+            for(int j = 0; j < c->size; j++) {
+                int id = c->rows[j];
+                if(!data->hidden[id]) {
+                    data->hidden[id] = true;
+                    data->hidden_rows[data->hidden_count++] = id;
+                    hide(data, id);
+                }
+            }
+        }
+    }
+}
+
+static void after(struct dlx_data *data, struct matrix_row *r) {
+    struct row_data *row_data = r->row_data;
+    data->current_score -= row_data->weight;
+    data->graph &= ~row_data->flags;
+    data->pieces &= ~(1u << rows[row_id(r)].piece);
+    data->k--;
+    for(int f = 0; f < 6; f++)
+        data->area[f] += rows[row_id(r)].area[f];
+
+    while(data->hidden_count > data->hidden_depth[data->k]) {
+        int id = data->hidden_rows[--data->hidden_count];
+        data->hidden[id] = false;
+        show(data, id);
+    }
+}
+
+/**
+ * @param d[in] The data of the current thread.
+ * @param tile An empty tile of the component.
+ * @param component The empty tiles which are connected to the tile.
+ *
+ * @return True iff a live row covers the tile without leaving the component.
+ */
+static bool fits(struct dlx_data *d, int tile, uint64_t component) {
+    struct column *c = &columns[tile];
+    for(int i = 0; i < c->size; i++) {
+        int id = c->rows[i];
+        if(!d->hidden[id] && !(rows[id].flags & ~component))
+            return true;
+    }
+    return false;
+}
+
+static bool flood_fill(struct dlx_data *d) {
+    uint64_t empty = ~d->graph & ((1llu << 60) - 1);
+    while(empty) {
+        /* Grow the component of the first empty tile one layer at a time. */
+        int tile = __builtin_ctzll(empty);
+        uint64_t component = 1llu << tile, frontier = component;
+        while(frontier) {
+            uint64_t next = 0;
+            for(; frontier; frontier &= frontier - 1)
+                next |= neighbours[__builtin_ctzll(frontier)];
+            frontier = next & empty & ~component;
+            component |= frontier;
+        }
+
+        /* The component can't be covered by the remaining pieces. */
+        if(__builtin_popcountll(component) % 5 != 0 || !fits(d, tile, component))
+            return true;
+        empty &= ~component;
+    }
+    return false;
+}
+
+/**
+ * Rounds the epsilons up to whole sixths for the given best score, which rarely changes.
+ *
+ * @param d[in,out] The data of the current thread.
+ * @param best The best score.
+ */
+static void update_target(struct dlx_data *d, int best) {
+    d->target = best + d->epsilon + (int) ceil(d->relative_epsilon * best - 1e-6);
+    d->target_best = best;
+}
+
+/**
+ * @param d[in,out] The data of the current thread.
+ * @param best The best score.
+ *
+ * @return The score which the completions of a branch have to reach for it to be searched.
+ */
+static inline int target_score(struct dlx_data *d, int best) {
+    if(unlikely(best != d->target_best)) update_target(d, best);
+    return d->target;
+}
+
+/**
+ * @param d[in] The data of the current thread.
+ * @param bound The highest score of the completions of the current packing.
+ *
+ * @return True iff the completions can't beat the best score by more than the epsilons.
+ */
+static inline bool beaten(struct dlx_data *d, int bound) {
+    int best = best_score(d);
+    if(bound < best) return true;
+    if(likely(bound >= target_score(d, best))) return false;
+    /* The completions may have beaten the best score. */
+    if(bound > d->pruned_bound) d->pruned_bound = bound;
+    return true;
+}
+
+static bool piece_max(struct dlx_data *d) {
+    /* One of the remaining pieces can no longer be placed. */
+    if(d->empty > d->k) return true;
+    return beaten(d, d->current_score + d->bound);
+}
+
+/**
+ * Bounds the weight of the remaining pieces by the maximum flow from the pieces to the faces. Each
+ * piece carries at most its maximum live weight, at most its maximum live weight on a face to that
+ * face, and each face takes at most its uncovered area. The flow is the minimum of the cuts, each
+ * of which separates a subset of the faces from the sink and the rest of them from the pieces.
+ *
+ * @param d[in] The data of the current thread.
+ * @return The upper bound of the weight of the remaining pieces in sixths.
+ */
+static int face_bound(struct dlx_data *d) {
+    /* The capacity of the cut of each subset of the faces, starting with the edges to the sink. */
+    int cut[64];
+    cut[0] = 0;
+    for(int s = 1; s < 64; s++)
+        cut[s] = cut[s & (s - 1)] + d->area[__builtin_ctz(s)];
+
+    for(uint32_t pieces = ~d->pieces & 0xfff; pieces; pieces &= pieces - 1) {
+        int p = __builtin_ctz(pieces), max = max_weight(d->weights[p]);
+        int weight[6], outside[64];
+        outside[0] = 0;
+        for(int f = 0; f < 6; f++)
+            weight[f] = max_weight(d->face_weights[p][f]), outside[0] += weight[f];
+
+        /* Either the edge from the source or those to the faces outside of the subset are cut. */
+        cut[0] += outside[0] < max ? outside[0] : max;
+        for(int s = 1; s < 64; s++) {
+            outside[s] = outside[s & (s - 1)] - weight[__builtin_ctz(s)];
+            cut[s] += outside[s] < max ? outside[s] : max;
+        }
+    }
+
+    int bound = INT_MAX;
+    for(int s = 0; s < 64; s++)
+        if(cut[s] < bound) bound = cut[s];
+    return bound;
+}
+
+static bool face_max(struct dlx_data *d) {
+    return beaten(d, d->current_score + face_bound(d));
+}
+
+static bool check_max(struct dlx_data *d) {
+    return beaten(d, d->current_score + 29 * (12 - d->k));
+}
+
+static bool transposition(struct dlx_data *d) {
+    int bound;
+    return d->table && table_get(d->table, d->graph, d->pieces, &bound) &&
+           beaten(d, d->current_score + bound);
+}
+
+/**
+ * Stores the bound of the current packing, all of whose completions have been searched. None of
+ * them beat the best score by more than the epsilons, except for those which became the best score.
+ *
+ * @param d[in] The data of the current thread.
+ */
+static inline void explored(struct dlx_data *d) {
+    if(d->table) {
+        table_put(d->table, d->graph, d->pieces, target_score(d, best_score(d)) - d->current_score);
+    }
+}
+
+/*
+ * The search with the callbacks and heuristics above inlined. The heuristics are called in the
+ * same order as by the solver and are indexed by the order in which they are added.
+ */
+#define DLX_SEARCH cube_search
+#define DLX_BEFORE(dlx_data, row) before(dlx_data, row)
+#define DLX_AFTER(dlx_data, row) after(dlx_data, row)
+#define DLX_HEURISTICS(dlx_data, depth) (                     \
+    DLX_HEURISTIC(dlx, depth, 4, check_max(dlx_data)) ||      \
+    DLX_HEURISTIC(dlx, depth, 3, piece_max(dlx_data)) ||      \
+    DLX_HEURISTIC(dlx, depth, 2, transposition(dlx_data)) ||  \
+    DLX_HEURISTIC(dlx, depth, 1, face_max(dlx_data)) ||       \
+    DLX_HEURISTIC(dlx, depth, 0, flood_fill(dlx_data)))
+#define DLX_CALLBACK(context) solution_callback(context)
+#define DLX_EXPLORED(dlx_data, depth) explored(dlx_data)
+#include "dlx_search.h"
+
+struct dlx_solver *packing_new(struct matrix_row *matrix, enum dlx_backend backend) {
+    struct dlx_solver *solver = dlx_new_backend(72, backend);
+    row_count = 0;
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        dlx_row(solver, i), row_count++;
+
+    /* Index the rows by their columns. */
+    for(int i = 0; i < 72; i++)
+        columns[i].rows = malloc_s(row_count * sizeof(*columns[i].rows)), columns[i].size = 0;
+    rows = malloc_s(row_count * sizeof(*rows));
+    for(struct matrix_row *i = matrix; i; i = i->next) {
+        for(int j = 0; j < 72; j++) {
+            if(!dlx_has(i, j)) continue;
+            columns[j].rows[columns[j].size++] = row_id(i);
+            if(j >= 60) rows[row_id(i)].piece = j - 60;
+        }
+        struct row_data *row_data = i->row_data;
+        struct row_info *r = &rows[row_id(i)];
+        r->flags = row_data->flags;
+        r->sixths = row_data->weight;
+
+        /* The row is scored on the first face on which it has its weight. */
+        r->face = -1;
+        for(int f = 0; f < 6; f++) {
+            r->area[f] = (uint8_t) face_area(r->flags, f);
+            if(r->face < 0 && r->area[f] == r->sixths) r->face = f;
+        }
+    }
+
+    for(int i = 0; i < 60; i++)
+        for(int j = 0; j < 4; j++)
+            neighbours[i] |= 1llu << (unsigned) NEIGHBOUR_MATRIX[i][j];
+
+    dlx_set_callback(solver, solution_callback);
+    dlx_set_ba(solver, (dlx_data_callback) before,
+                       (dlx_data_callback) after);
+
+    dlx_add_heuristic(solver, (dlx_heuristic_callback) flood_fill);
+    dlx_add_heuristic(solver, (dlx_heuristic_callback) face_max);
+    dlx_add_heuristic(solver, (dlx_heuristic_callback) transposition);
+    dlx_add_heuristic(solver, (dlx_heuristic_callback) piece_max);
+    dlx_add_heuristic(solver, (dlx_heuristic_callback) check_max);
+    dlx_set_search(solver, cube_search);
+    return solver;
+}
+
+void packing_free(struct dlx_solver *solver) {
+    dlx_free(solver);
+    for(int i = 0; i < 72; i++)
+        free(columns[i].rows);
+    free(rows);
+}
+
+void packing_data_init(struct dlx_data *data, _Atomic int *best_score, struct sink *sink, struct table *table,
+                       struct topk *topk) {
+    *data = (struct dlx_data) { .best_score = best_score, .sink = sink, .table = table, .topk = topk };
+    data->hidden = calloc_s(row_count, sizeof(*data->hidden));
+    data->hidden_rows = malloc_s(row_count * sizeof(*data->hidden_rows));
+
+    data->empty = 12;
+    for(int i = 0; i < row_count; i++)
+        show(data, i);
+    for(int f = 0; f < 6; f++)
+        data->area[f] = face_area((1llu << 60) - 1, f);
+}
+
+void packing_data_set_epsilon(struct dlx_data *data, double epsilon, double relative_epsilon) {
+    data->epsilon = (int) ceil(epsilon - 1e-6), data->relative_epsilon = relative_epsilon;
+    update_target(data, best_score(data));
+}
+
+double packing_bound(struct dlx_data *data) {
+    /* The flow is at most the sum of the maximum weights, which is at most 29 per piece. */
+    return data->current_score + face_bound(data);
+}
+
+void packing_data_set_stop(struct dlx_data *data, int score, _Atomic uint64_t *found, uint64_t count) {
+    data->stop_score = score;
+    data->found = count ? found : NULL, data->stop_count = count;
+}
+
+void packing_data_free(struct dlx_data *data) {
+    free(data->hidden);
+    free(data->hidden_rows);
+}
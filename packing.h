@@ -0,0 +1,149 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PACKING_H
+#define PACKING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dlx.h"
+#include "sink.h"
+#include "table.h"
+#include "topk.h"
+
+/* The state of one thread searching for the packing with the highest score, every score is in sixths. */
+struct dlx_data {
+    /* The number of live rows of each piece for each weight in sixths. */
+    int live[12][32];
+    /* The weights in sixths for which each piece has live rows. */
+    uint32_t weights[12];
+    /* The sum of the maximum live weight of each piece in sixths. */
+    int bound;
+    /* The number of pieces without live rows. */
+    int empty;
+    /* The number of live rows of each piece for each face and weight in sixths. A row counts for the
+     * first face on which its piece has the row's weight. */
+    int face_live[12][6][32];
+    /* The weights in sixths for which each piece has live rows on each face. */
+    uint32_t face_weights[12][6];
+    /* The uncovered area of each face in sixths. */
+    int area[6];
+    /* Marks the rows which intersect the current solution. */
+    bool *hidden;
+    /* The ids of the hidden rows in the order they were hidden. */
+    int *hidden_rows, hidden_count;
+    /* The number of hidden rows before each of the current solution's rows. */
+    int hidden_depth[12];
+
+    /* The best score found by any of the threads. */
+    _Atomic int *best_score;
+    int current_score;
+    uint64_t graph;
+    /* The pieces of the current packing. */
+    uint32_t pieces;
+    int k;
+    /* The bounds of the packings which have been searched or NULL. */
+    struct table *table;
+
+    /* The number of rows which were added to the packing. */
+    uint64_t nodes;
+    /* The sink to which the best packings are written or NULL. */
+    struct sink *sink;
+    /* Keeps the best distinct packings instead of writing them as they are found or NULL. */
+    struct topk *topk;
+
+    /* The absolute amount in sixths and the relative amount by which a branch has to beat the best score. */
+    int epsilon;
+    double relative_epsilon;
+    /* The score in sixths which a branch has to reach for the best score target_best, see target_score. */
+    int target, target_best;
+    /* The highest bound of a branch which was only pruned because of the epsilons or 0. */
+    int pruned_bound;
+
+    /* The search stops once a packing reaches this score, 0 to search for the best one. */
+    int stop_score;
+    /* Counts the packings found by the threads or NULL, the search stops once stop_count were found. */
+    _Atomic uint64_t *found;
+    uint64_t stop_count;
+};
+
+/**
+ * Creates a solver which searches the given rows for the packing with the highest score. The rows
+ * are indexed by their id, which must be less than the number of rows. Only one of these solvers
+ * may exist at a time.
+ *
+ * @param matrix[in] The weight sorted rows of the cover matrix.
+ * @param backend The engine which is to be used.
+ *
+ * @return A new solver with the callbacks and heuristics of the packing search.
+ */
+struct dlx_solver *packing_new(struct matrix_row *matrix, enum dlx_backend backend);
+
+/**
+ * @param solver[in] The solver created by packing_new which is to be freed.
+ */
+void packing_free(struct dlx_solver *solver);
+
+/**
+ * Initializes the data of a thread with every row being live.
+ *
+ * @param data[out] The data which is to be initialized.
+ * @param best_score[in] The best score which is shared by the threads.
+ * @param sink[in] The sink to which the best packings are written or NULL.
+ * @param table[in] The transposition table which is shared by the threads or NULL.
+ * @param topk[in] The best distinct packings which are shared by the threads or NULL.
+ */
+void packing_data_init(struct dlx_data *data, _Atomic int *best_score, struct sink *sink, struct table *table,
+                       struct topk *topk);
+
+/**
+ * Prunes every branch which can't beat the best score by more than the epsilons, the optimum is
+ * then at most the larger one of the best score and the pruned_bound of every thread.
+ *
+ * @param data[in,out] The data whose pruning is to be relaxed.
+ * @param epsilon The absolute amount in sixths by which a branch has to be able to beat the best score,
+ *                which is rounded up to whole sixths like the relative amount.
+ * @param relative_epsilon The amount relative to the best score by which it has to beat it.
+ */
+void packing_data_set_epsilon(struct dlx_data *data, double epsilon, double relative_epsilon);
+
+/**
+ * Stops the search early, once a packing reaches the given score or enough packings have been
+ * found, the search is then paused like by dlx_stop.
+ *
+ * @param data[in,out] The data whose search is to be stopped early.
+ * @param score The score in sixths which is good enough or 0 to search for the best one.
+ * @param found[in] Counts the packings which have been found by the threads.
+ * @param count The number of packings after which the search stops or 0 for no limit.
+ */
+void packing_data_set_stop(struct dlx_data *data, int score, _Atomic uint64_t *found, uint64_t count);
+
+/**
+ * @param data[in] The data of a thread.
+ * @return An upper bound of the scores of the completions of the thread's current packing in sixths.
+ */
+double packing_bound(struct dlx_data *data);
+
+/**
+ * @param data[in] The data which is to be freed.
+ */
+void packing_data_free(struct dlx_data *data);
+
+#endif /* PACKING_H */
@@ -0,0 +1,40 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cube.h"
+
+/* Generated at build time by generate.c. */
+#include "placements.h"
+
+static struct matrix_row rows[PLACEMENT_COUNT];
+static struct row_data rows_data[PLACEMENT_COUNT];
+static uint64_t rows_columns[PLACEMENT_COUNT][2];
+
+struct matrix_row *load_walks() {
+    for(int i = 0; i < PLACEMENT_COUNT; i++) {
+        const struct placement *p = &PLACEMENTS[i];
+        rows_data[i] = (struct row_data) { p->weight, p->flags, i };
+        rows[i] = (struct matrix_row) {
+            rows_columns[i], &rows_data[i],
+            i > 0 ? &rows[i - 1] : NULL,
+            i + 1 < PLACEMENT_COUNT ? &rows[i + 1] : NULL
+        };
+        rows_columns[i][0] = p->flags, rows_columns[i][1] = 0;
+        dlx_set(&rows[i], p->piece + 60);
+    }
+    return rows;
+}
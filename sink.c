@@ -0,0 +1,200 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sink.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "cube.h"
+#include "globals.h"
+
+/* A solution which is waiting to be written. */
+struct entry {
+    /* The score in sixths. */
+    int score;
+    int count;
+    uint16_t ids[SINK_ROWS];
+};
+
+struct sink {
+    FILE *output;
+    enum sink_format format;
+    /* The rows of the matrix indexed by their id. */
+    struct matrix_row **rows;
+    int row_count;
+
+    /* The ring buffer of queued solutions, which are at head + i modulo capacity. */
+    struct entry *entries;
+    int capacity, head, size;
+    bool closed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready, space;
+    pthread_t writer;
+};
+
+void sink_print(FILE *output, double score, struct matrix_row *const rows[], int count) {
+    fprintf(output, "Score: %f\n", score);
+    for(int i = 0; i < count; i++) {
+        for(int j = 0; j < 60; j++)
+            if(dlx_has(rows[i], j))
+                fprintf(output, "%d ", j);
+        for(int j = 0; j < 12; j++)
+            if(dlx_has(rows[i], j + 60))
+                fprintf(output, "[%d] ", j);
+        fprintf(output, "\n");
+    }
+    fprintf(output, "\n");
+}
+
+/**
+ * @param sink[in] The sink to which the solution belongs.
+ * @param e[in] The solution which is to be written.
+ */
+static void write_entry(struct sink *sink, struct entry *e) {
+    if(sink->format == SINK_BINARY) {
+        uint8_t count = e->count;
+        double score = e->score / 6.0;
+        fwrite(&score, sizeof(score), 1, sink->output);
+        fwrite(&count, sizeof(count), 1, sink->output);
+        fwrite(e->ids, sizeof(*e->ids), e->count, sink->output);
+    } else {
+        struct matrix_row *rows[SINK_ROWS];
+        for(int i = 0; i < e->count; i++)
+            rows[i] = sink->rows[e->ids[i]];
+        sink_print(sink->output, e->score / 6.0, rows, e->count);
+    }
+}
+
+/**
+ * Writes the queued solutions in batches until the sink is closed.
+ *
+ * @param arg[in] The sink whose solutions are to be written.
+ * @return NULL.
+ */
+static void *writer_run(void *arg) {
+    struct sink *sink = arg;
+    int batch_capacity = sink->capacity;
+    struct entry *batch = malloc_s(batch_capacity * sizeof(*batch));
+    pthread_mutex_lock(&sink->lock);
+    for(;;) {
+        while(!sink->size && !sink->closed)
+            pthread_cond_wait(&sink->ready, &sink->lock);
+        if(!sink->size) break;
+
+        /* Copy the queued solutions so that the searching threads aren't held up by the output. */
+        int count = sink->size;
+        if(count > batch_capacity) {
+            batch_capacity = sink->capacity;
+            batch = realloc_s(batch, batch_capacity * sizeof(*batch));
+        }
+        for(int i = 0; i < count; i++)
+            batch[i] = sink->entries[(sink->head + i) % sink->capacity];
+        sink->head = (sink->head + count) % sink->capacity;
+        sink->size = 0;
+        pthread_cond_broadcast(&sink->space);
+        pthread_mutex_unlock(&sink->lock);
+
+        for(int i = 0; i < count; i++)
+            write_entry(sink, &batch[i]);
+        fflush(sink->output);
+        pthread_mutex_lock(&sink->lock);
+    }
+    pthread_mutex_unlock(&sink->lock);
+    free(batch);
+    return NULL;
+}
+
+struct sink *sink_new(FILE *output, enum sink_format format, struct matrix_row *matrix, int capacity) {
+    struct sink *sink = calloc_s(1, sizeof(*sink));
+    sink->output = output;
+    sink->format = format;
+    sink->capacity = capacity;
+    sink->entries = malloc_s(capacity * sizeof(*sink->entries));
+
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        sink->row_count++;
+    sink->rows = malloc_s(sink->row_count * sizeof(*sink->rows));
+    for(struct matrix_row *i = matrix; i; i = i->next)
+        sink->rows[((struct row_data *) i->row_data)->id] = i;
+
+    if(format == SINK_BINARY) {
+        uint32_t row_count = sink->row_count;
+        fwrite(SINK_MAGIC, 1, strlen(SINK_MAGIC), output);
+        fwrite(&row_count, sizeof(row_count), 1, output);
+    }
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->ready, NULL);
+    pthread_cond_init(&sink->space, NULL);
+    pthread_create(&sink->writer, NULL, writer_run, sink);
+    return sink;
+}
+
+/**
+ * @param score The score of the solution in sixths.
+ * @param solution[in] The rows of the solution.
+ *
+ * @return The entry recording the solution.
+ */
+static struct entry entry_new(int score, struct dlx_solution *solution) {
+    struct entry e = { .score = score };
+    for(struct dlx_solution *i = solution; i && e.count < SINK_ROWS; i = i->next)
+        e.ids[e.count++] = ((struct row_data *) i->row->row_data)->id;
+    return e;
+}
+
+void sink_push(struct sink *sink, int score, struct dlx_solution *solution) {
+    struct entry e = entry_new(score, solution);
+    pthread_mutex_lock(&sink->lock);
+    if(sink->size == sink->capacity) {
+        /* Double the queue, moving the solutions which wrap around behind the old ones. */
+        sink->entries = realloc_s(sink->entries, 2 * sink->capacity * sizeof(*sink->entries));
+        for(int i = 0; i < sink->head; i++)
+            sink->entries[sink->capacity + i] = sink->entries[i];
+        sink->capacity *= 2;
+    }
+    sink->entries[(sink->head + sink->size++) % sink->capacity] = e;
+    pthread_cond_signal(&sink->ready);
+    pthread_mutex_unlock(&sink->lock);
+}
+
+void sink_put(struct sink *sink, int score, struct dlx_solution *solution) {
+    struct entry e = entry_new(score, solution);
+    pthread_mutex_lock(&sink->lock);
+    while(sink->size == sink->capacity)
+        pthread_cond_wait(&sink->space, &sink->lock);
+    sink->entries[(sink->head + sink->size++) % sink->capacity] = e;
+    pthread_cond_signal(&sink->ready);
+    pthread_mutex_unlock(&sink->lock);
+}
+
+void sink_free(struct sink *sink) {
+    pthread_mutex_lock(&sink->lock);
+    sink->closed = true;
+    pthread_cond_signal(&sink->ready);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->writer, NULL);
+
+    pthread_mutex_destroy(&sink->lock);
+    pthread_cond_destroy(&sink->ready);
+    pthread_cond_destroy(&sink->space);
+    free(sink->entries);
+    free(sink->rows);
+    free(sink);
+}
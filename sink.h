@@ -0,0 +1,95 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dlx.h"
+
+/* The most rows of a solution which are recorded. */
+#define SINK_ROWS 12
+
+/* Identifies a stream of solutions in the binary format. */
+#define SINK_MAGIC "DLXS"
+
+enum sink_format {
+    /* The scores and the tiles and pieces of each row as text. */
+    SINK_TEXT,
+    /*
+     * A header of SINK_MAGIC and the number of rows as an uint32_t, followed by the solutions, each
+     * of which is the score as a double, the number of rows as an uint8_t and the ids of the rows as
+     * uint16_ts. Every value is stored in native byte order.
+     */
+    SINK_BINARY
+};
+
+/* A queue of solutions which are written by a separate thread. */
+struct sink;
+
+/**
+ * Creates a sink and starts its writer thread.
+ *
+ * @param output[in] The stream to which the solutions are written.
+ * @param format The format in which the solutions are written.
+ * @param matrix[in] The rows of the solutions, which are indexed by the id of their row_data.
+ * @param capacity The number of solutions which may be queued before the queue grows.
+ *
+ * @return A new sink.
+ */
+struct sink *sink_new(FILE *output, enum sink_format format, struct matrix_row *matrix, int capacity);
+
+/**
+ * Queues a solution without waiting for the output. The queue grows if it is full, so that no
+ * solution is lost.
+ *
+ * @param sink[in] The sink to which the solution is to be added.
+ * @param score The score of the solution in sixths.
+ * @param solution[in] The rows of the solution, only the first SINK_ROWS of which are recorded.
+ */
+void sink_push(struct sink *sink, int score, struct dlx_solution *solution);
+
+/**
+ * Queues a solution, waiting for the writer thread if the queue is full.
+ *
+ * @param sink[in] The sink to which the solution is to be added.
+ * @param score The score of the solution in sixths.
+ * @param solution[in] The rows of the solution, only the first SINK_ROWS of which are recorded.
+ */
+void sink_put(struct sink *sink, int score, struct dlx_solution *solution);
+
+/**
+ * Writes the queued solutions, stops the writer thread and frees the sink.
+ *
+ * @param sink[in] The sink which is to be freed.
+ */
+void sink_free(struct sink *sink);
+
+/**
+ * Prints a solution in the text format.
+ *
+ * @param output[in] The stream to which the solution is printed.
+ * @param score The score of the solution.
+ * @param rows[in] The rows of the solution.
+ * @param count The number of rows.
+ */
+void sink_print(FILE *output, double score, struct matrix_row *const rows[], int count);
+
+#endif /* SINK_H */
@@ -0,0 +1,72 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "table.h"
+
+#include "globals.h"
+
+/**
+ * @param tiles The tiles which are covered.
+ * @param pieces The pieces which are used.
+ *
+ * @return The hash of the state.
+ */
+static inline uint64_t table_hash(uint64_t tiles, uint32_t pieces) {
+    uint64_t h = tiles ^ (uint64_t) pieces << 52 ^ (uint64_t) pieces * 0x9e3779b97f4a7c15llu;
+    h = (h ^ h >> 30) * 0xbf58476d1ce4e5b9llu;
+    h = (h ^ h >> 27) * 0x94d049bb133111ebllu;
+    return h ^ h >> 31;
+}
+
+/**
+ * @param pieces The pieces which are used.
+ * @param bound The bound of the state.
+ *
+ * @return The data word of an entry.
+ */
+static inline uint64_t table_data(uint32_t pieces, int bound) {
+    return (uint64_t) pieces << 32 | (uint32_t) bound;
+}
+
+struct table *table_new(int bits) {
+    struct table *table = malloc_s(sizeof(*table));
+    table->mask = (1llu << bits) - 1;
+    table->entries = calloc_s(table->mask + 1, sizeof(*table->entries));
+    return table;
+}
+
+void table_free(struct table *table) {
+    free(table->entries);
+    free(table);
+}
+
+bool table_get(struct table *table, uint64_t tiles, uint32_t pieces, int *bound) {
+    _Atomic uint64_t *e = table->entries[table_hash(tiles, pieces) & table->mask];
+    uint64_t key = atomic_load_explicit(&e[0], memory_order_relaxed);
+    uint64_t data = atomic_load_explicit(&e[1], memory_order_relaxed);
+    if((key ^ data) != tiles || data >> 32 != pieces)
+        return false;
+    *bound = (int) (uint32_t) data;
+    return true;
+}
+
+void table_put(struct table *table, uint64_t tiles, uint32_t pieces, int bound) {
+    _Atomic uint64_t *e = table->entries[table_hash(tiles, pieces) & table->mask];
+    uint64_t data = table_data(pieces, bound);
+    atomic_store_explicit(&e[0], tiles ^ data, memory_order_relaxed);
+    atomic_store_explicit(&e[1], data, memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The default base 2 logarithm of the number of entries, which take 16 bytes each. */
+#define TABLE_DEFAULT_BITS 20
+
+/*
+ * A fixed-size hash table mapping the covered tiles and used pieces of a partial packing to an
+ * upper bound on the score which its completions can add. Each entry stores the key XORed with its
+ * data next to the data, so that the threads may share the table without locks and a torn entry is
+ * rejected as a miss.
+ */
+struct table {
+    _Atomic uint64_t (*entries)[2];
+    uint64_t mask;
+};
+
+/**
+ * @param bits The base 2 logarithm of the number of entries.
+ * @return A new empty table.
+ */
+struct table *table_new(int bits);
+
+/**
+ * @param table[in] The table which is to be freed.
+ */
+void table_free(struct table *table);
+
+/**
+ * @param table[in] The table which is to be searched.
+ * @param tiles The tiles which are covered.
+ * @param pieces The pieces which are used.
+ * @param bound[out] The bound stored for the state.
+ *
+ * @return True iff the table contains the state.
+ */
+bool table_get(struct table *table, uint64_t tiles, uint32_t pieces, int *bound);
+
+/**
+ * Stores the bound of a state, replacing whichever state was stored in its entry.
+ *
+ * @param table[in] The table to which the state is to be added.
+ * @param tiles The tiles which are covered.
+ * @param pieces The pieces which are used.
+ * @param bound The upper bound of the score which completions of the state can add.
+ */
+void table_put(struct table *table, uint64_t tiles, uint32_t pieces, int bound);
+
+#endif /* TABLE_H */
@@ -0,0 +1,291 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "topk.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "cube.h"
+#include "globals.h"
+
+/* A kept packing. */
+struct packing {
+    /* The score in sixths. */
+    int score;
+    /* The tiles of each piece in the smallest image of the packing under the symmetries. */
+    uint64_t key[12];
+    struct matrix_row *rows[12];
+    int count;
+};
+
+/* An entry of the set of the keys of the kept packings. */
+struct key_slot {
+    uint64_t key[12];
+    uint64_t hash;
+    bool used;
+};
+
+struct topk {
+    /* The kept packings, a min-heap by score if k > 0. */
+    struct packing *packings;
+    int k, size, capacity;
+    /* The keys of the kept packings, hashed with linear probing and at most half full. */
+    struct key_slot *keys;
+    size_t key_mask;
+    _Atomic int *threshold;
+    pthread_mutex_t lock;
+};
+
+struct topk *topk_new(int k, _Atomic int *threshold) {
+    struct topk *topk = calloc_s(1, sizeof(*topk));
+    topk->k = k;
+    topk->threshold = threshold;
+    topk->capacity = k ? k : 16;
+    topk->packings = malloc_s(topk->capacity * sizeof(*topk->packings));
+    topk->key_mask = 31;
+    while(topk->key_mask < 2 * (size_t) topk->capacity) topk->key_mask = topk->key_mask << 1 | 1;
+    topk->keys = calloc_s(topk->key_mask + 1, sizeof(*topk->keys));
+    pthread_mutex_init(&topk->lock, NULL);
+    return topk;
+}
+
+void topk_free(struct topk *topk) {
+    pthread_mutex_destroy(&topk->lock);
+    free(topk->packings);
+    free(topk->keys);
+    free(topk);
+}
+
+/**
+ * @param tiles The tiles which are to be mapped.
+ * @param symmetry The index of the symmetry.
+ *
+ * @return The image of the tiles under the symmetry.
+ */
+static uint64_t map_tiles(uint64_t tiles, int symmetry) {
+    uint64_t image = 0;
+    for(; tiles; tiles &= tiles - 1)
+        image |= 1llu << SYMMETRY_MATRIX[symmetry][__builtin_ctzll(tiles)];
+    return image;
+}
+
+/**
+ * Records the rows of the solution and the smallest of its images under the symmetries.
+ *
+ * @param p[out] The packing which is to be initialized.
+ * @param score The score of the packing in sixths.
+ * @param solution[in] The rows of the packing.
+ */
+static void packing_init(struct packing *p, int score, struct dlx_solution *solution) {
+    uint64_t tiles[12] = { };
+    p->score = score, p->count = 0;
+    for(struct dlx_solution *i = solution; i && p->count < 12; i = i->next) {
+        p->rows[p->count++] = i->row;
+        for(int j = 0; j < 12; j++)
+            if(dlx_has(i->row, j + 60))
+                tiles[j] = ((struct row_data *) i->row->row_data)->flags;
+    }
+
+    for(int s = 0; s < SYMMETRY_COUNT; s++) {
+        uint64_t image[12];
+        for(int j = 0; j < 12; j++)
+            image[j] = map_tiles(tiles[j], s);
+        /* Compare the images piece by piece. */
+        int j = 0;
+        while(j < 12 && image[j] == p->key[j]) j++;
+        if(!s || (j < 12 && image[j] < p->key[j]))
+            memcpy(p->key, image, sizeof(image));
+    }
+}
+
+/**
+ * @param key[in] The key which is to be hashed.
+ * @return The hash of the key.
+ */
+static uint64_t key_hash(const uint64_t *key) {
+    uint64_t hash = 0;
+    for(int i = 0; i < 12; i++) {
+        hash = (hash ^ key[i]) * 0xbf58476d1ce4e5b9llu;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+/**
+ * @param topk[in] The packings whose keys are to be searched.
+ * @param key[in] The key which is to be found.
+ * @param hash The hash of the key.
+ *
+ * @return The slot of the key or the empty slot where it belongs.
+ */
+static struct key_slot *key_find(struct topk *topk, const uint64_t *key, uint64_t hash) {
+    for(size_t i = hash & topk->key_mask; ; i = (i + 1) & topk->key_mask) {
+        struct key_slot *slot = &topk->keys[i];
+        if(!slot->used || (slot->hash == hash && !memcmp(slot->key, key, sizeof(slot->key))))
+            return slot;
+    }
+}
+
+/**
+ * @param topk[in] The packings which are to be searched.
+ * @param p[in] The packing which is to be found.
+ *
+ * @return True iff one of the kept packings is an image of the packing.
+ */
+static bool topk_contains(struct topk *topk, struct packing *p) {
+    return key_find(topk, p->key, key_hash(p->key))->used;
+}
+
+/**
+ * Adds the key of a packing which isn't kept yet, growing the set once it is half full.
+ *
+ * @param topk[in,out] The packings whose keys are to be updated.
+ * @param p[in] The packing which is to be kept.
+ */
+static void key_insert(struct topk *topk, struct packing *p) {
+    if(2 * (size_t) (topk->size + 1) > topk->key_mask) {
+        struct key_slot *old = topk->keys;
+        size_t old_count = topk->key_mask + 1;
+        topk->key_mask = topk->key_mask << 1 | 1;
+        topk->keys = calloc_s(topk->key_mask + 1, sizeof(*topk->keys));
+        for(size_t i = 0; i < old_count; i++)
+            if(old[i].used)
+                *key_find(topk, old[i].key, old[i].hash) = old[i];
+        free(old);
+    }
+    uint64_t hash = key_hash(p->key);
+    struct key_slot *slot = key_find(topk, p->key, hash);
+    memcpy(slot->key, p->key, sizeof(slot->key));
+    slot->hash = hash, slot->used = true;
+}
+
+/**
+ * Removes the key of a kept packing, moving the following keys of its run back into the hole.
+ *
+ * @param topk[in,out] The packings whose keys are to be updated.
+ * @param p[in] The packing which is no longer kept.
+ */
+static void key_remove(struct topk *topk, struct packing *p) {
+    size_t hole = key_find(topk, p->key, key_hash(p->key)) - topk->keys;
+    for(size_t i = (hole + 1) & topk->key_mask; topk->keys[i].used; i = (i + 1) & topk->key_mask) {
+        /* A key may fill the hole unless its home lies cyclically in (hole, i]. */
+        size_t home = topk->keys[i].hash & topk->key_mask;
+        if(((i - home) & topk->key_mask) >= ((i - hole) & topk->key_mask)) {
+            topk->keys[hole] = topk->keys[i];
+            hole = i;
+        }
+    }
+    topk->keys[hole].used = false;
+}
+
+/**
+ * Restores the heap property below the given packing.
+ * @param topk[in,out] The heap which is to be fixed.
+ * @param i The index of the packing which may be larger than its children.
+ */
+static void sift_down(struct topk *topk, int i) {
+    struct packing *h = topk->packings;
+    for(;;) {
+        int min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if(l < topk->size && h[l].score < h[min].score) min = l;
+        if(r < topk->size && h[r].score < h[min].score) min = r;
+        if(min == i) return;
+        struct packing tmp = h[i];
+        h[i] = h[min], h[min] = tmp;
+        i = min;
+    }
+}
+
+/**
+ * Restores the heap property above the given packing.
+ * @param topk[in,out] The heap which is to be fixed.
+ * @param i The index of the packing which may be smaller than its parent.
+ */
+static void sift_up(struct topk *topk, int i) {
+    struct packing *h = topk->packings;
+    for(; i > 0 && h[i].score < h[(i - 1) / 2].score; i = (i - 1) / 2) {
+        struct packing tmp = h[i];
+        h[i] = h[(i - 1) / 2], h[(i - 1) / 2] = tmp;
+    }
+}
+
+void topk_add(struct topk *topk, int score, struct dlx_solution *solution) {
+    pthread_mutex_lock(&topk->lock);
+    int threshold = atomic_load(topk->threshold);
+    bool full = topk->k && topk->size == topk->k;
+    if((full && score <= topk->packings[0].score) || (!topk->k && score < threshold)) {
+        pthread_mutex_unlock(&topk->lock);
+        return;
+    }
+
+    struct packing p;
+    packing_init(&p, score, solution);
+    if(!topk->k && score > threshold) {
+        /* A better score makes the packings tied for the previous one obsolete. */
+        topk->size = 0;
+        memset(topk->keys, 0, (topk->key_mask + 1) * sizeof(*topk->keys));
+        atomic_raise(topk->threshold, score);
+    } else if(topk_contains(topk, &p)) {
+        pthread_mutex_unlock(&topk->lock);
+        return;
+    }
+
+    if(topk->k) {
+        key_insert(topk, &p);
+        if(full) {
+            key_remove(topk, &topk->packings[0]);
+            topk->packings[0] = p;
+            sift_down(topk, 0);
+        } else {
+            topk->packings[topk->size++] = p;
+            sift_up(topk, topk->size - 1);
+        }
+        /* Only packings beating the k-th best score can be added from now on. */
+        if(topk->size == topk->k)
+            atomic_raise(topk->threshold, topk->packings[0].score);
+    } else {
+        if(topk->size == topk->capacity) {
+            topk->capacity *= 2;
+            topk->packings = realloc_s(topk->packings, topk->capacity * sizeof(*topk->packings));
+        }
+        key_insert(topk, &p);
+        topk->packings[topk->size++] = p;
+    }
+    pthread_mutex_unlock(&topk->lock);
+}
+
+/**
+ * Orders packings by their score from the highest to the lowest.
+ */
+static int compare_packings(const void *a, const void *b) {
+    int x = ((const struct packing *) a)->score, y = ((const struct packing *) b)->score;
+    return x > y ? -1 : x < y ? 1 : 0;
+}
+
+void topk_write(struct topk *topk, struct sink *sink) {
+    struct packing *sorted = malloc_s(topk->size * sizeof(*sorted));
+    memcpy(sorted, topk->packings, topk->size * sizeof(*sorted));
+    qsort(sorted, topk->size, sizeof(*sorted), compare_packings);
+    for(int i = 0; i < topk->size; i++) {
+        struct dlx_solution solution[12], *next = NULL;
+        for(int j = sorted[i].count - 1; j >= 0; j--)
+            solution[j] = (struct dlx_solution) { sorted[i].rows[j], next }, next = &solution[j];
+        sink_put(sink, sorted[i].score, next);
+    }
+    free(sorted);
+}
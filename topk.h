@@ -0,0 +1,62 @@
+/*
+ *   This file is part of Cube-Solver (https://github.com/nur1popcorn/Cube-Solver).
+ *   Copyright (C) Keanu Poeschko
+ *
+ *   Cube-Solver is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, version 3.
+ *
+ *   Cube-Solver is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Cube-Solver.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stdatomic.h>
+
+#include "dlx.h"
+#include "sink.h"
+
+/* The best distinct packings, each of which is identified with its images under the symmetries. */
+struct topk;
+
+/**
+ * @param k The number of packings which are to be kept or 0 to keep every packing tied for the
+ *          best score.
+ * @param threshold[in,out] The score in sixths below which the search may prune, which is raised to the
+ *                          k-th best score once k packings are kept, or to the best score.
+ *
+ * @return A new empty set of packings.
+ */
+struct topk *topk_new(int k, _Atomic int *threshold);
+
+/**
+ * Adds a packing unless it is one of the kept packings under a symmetry or doesn't make the cut.
+ * This may be called by several threads at once.
+ *
+ * @param topk[in,out] The packings to which the packing is to be added.
+ * @param score The score of the packing in sixths.
+ * @param solution[in] The rows of the packing.
+ */
+void topk_add(struct topk *topk, int score, struct dlx_solution *solution);
+
+/**
+ * Writes the kept packings from the highest to the lowest score.
+ *
+ * @param topk[in] The packings which are to be written.
+ * @param sink[in] The sink to which the packings are written.
+ */
+void topk_write(struct topk *topk, struct sink *sink);
+
+/**
+ * @param topk[in] The packings which are to be freed.
+ */
+void topk_free(struct topk *topk);
+
+#endif /* TOPK_H */